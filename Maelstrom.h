@@ -76,11 +76,28 @@ typedef struct {
 	unsigned long	color;
 } Star, *StarPtr;
 
+/* A sprite's collision mask, a row of bits for each row of pixels with the
+   leftmost pixel in the top bit, 16 bits wide for small sprites.
+ */
+typedef union {
+	Uint16 *small;
+	Uint32 *large;
+} SpriteMask;
+
 /* Sprite blitting information structure */
 typedef	struct {
 	int numFrames;
 	int isSmall;
 	Rect hitRect;
-	SDL_Surface *sprite[MAX_SPRITE_FRAMES];
-	Uint8 *mask[MAX_SPRITE_FRAMES];
+	AtlasFrame sprite[MAX_SPRITE_FRAMES];
+	SpriteMask mask[MAX_SPRITE_FRAMES];
+	Rect bounds[MAX_SPRITE_FRAMES];	/* Around the pixels set in the mask */
 } Blit, *BlitPtr;
+
+/* Return whether a pixel is set in the collision mask of a sprite frame */
+static inline int MaskPixel(const Blit *blit, int frame, int x, int y)
+{
+	if ( blit->isSmall )
+		return((blit->mask[frame].small[y] >> (15-x)) & 1);
+	return((blit->mask[frame].large[y] >> (31-x)) & 1);
+}
@@ -47,6 +47,7 @@ extern int   NetLoadScores(void);
 extern Bool	gUpdateBuffer;
 extern Bool	gRunning;
 extern int	gNoDelay;
+extern int	gRefreshRate;
 
 // in init.cc : 
 extern Sint32	gLastHigh;
@@ -24,9 +24,6 @@ Controls controls =
 #endif
 SDL_Keymod gToggleFullscreenMod = KMOD_ALT;
 
-#ifdef MOVIE_SUPPORT
-int	gMovie = 0;
-#endif
 Uint8 gSoundLevel = 4;
 Uint8 gGammaCorrect = 3;
 
@@ -221,7 +218,7 @@ static void BoxKeyPress(SDL_Keysym key, int *doneflag)
 			key.sym = (SDL_Keycode)*checkboxes[currentbox].control;
 
 			/* Clear the current text */
-			fontserv->InvertText(keynames[currentbox]);
+			fontserv->InvertText(&keynames[currentbox]);
 			screen->QueueBlit(
 				X+96+(BOX_WIDTH-keynames[currentbox]->w)/2, 
 				Y+75+SP+checkboxes[currentbox].yoffset,
@@ -244,7 +241,7 @@ static void BoxKeyPress(SDL_Keysym key, int *doneflag)
 	}
 
 	/* Clear the current text */
-	fontserv->InvertText(keynames[currentbox]);
+	fontserv->InvertText(&keynames[currentbox]);
 	screen->QueueBlit(X+96+(BOX_WIDTH-keynames[currentbox]->w)/2, 
 				Y+75+SP+checkboxes[currentbox].yoffset,
 						keynames[currentbox], NOCLIP);
@@ -448,18 +445,23 @@ static void HandleEvent(SDL_Event *event)
 					 */
 					screen->ScreenDump("ScreenShot",
 								0, 0, 0, 0);
-#ifdef MOVIE_SUPPORT
-				} else if ( key == XK_F5 ) {
+				} else if ( key == SDLK_F5 ) {
 					/* Special key --
-						Toggle movie function.
+						Start or stop capturing the game.
 					 */
-					extern int SelectMovieRect(void);
-					if ( ! gMovie )
-						gMovie = SelectMovieRect();
-					else
-						gMovie = 0;
-mesg("Movie is %s...\n", gMovie ? "started" : "stopped");
-#endif
+					if ( screen->Capturing() ) {
+						if ( screen->StopCapture() < 0 ) {
+							error("Capture failed: %s\n",
+							screen->Error());
+						} else {
+							mesg("Capture is stopped...\n");
+						}
+					} else if ( screen->StartCapture("Capture") < 0 ) {
+						error("Couldn't start capture: %s\n",
+							screen->Error());
+					} else {
+						mesg("Capture is started...\n");
+					}
 				}
 			} else {
 				/* Update control key status */
@@ -715,7 +715,8 @@ extern "C" void CleanUp(void)
 
 /* ----------------------------------------------------------------- */
 /* -- Perform some initializations and report failure if we choke */
-int DoInitializations(Uint32 video_flags)
+int DoInitializations(Uint32 video_flags, Uint32 screen_options,
+							int screen_scale)
 {
 	LibPath library;
 	int i;
@@ -723,6 +724,11 @@ int DoInitializations(Uint32 video_flags)
 
 	/* Make sure we clean up properly at exit */
 	Uint32 init_flags = (SDL_INIT_VIDEO|SDL_INIT_AUDIO);
+	if ( screen_options & FRAMEBUF_HEADLESS ) {
+		/* Events still work without a display */
+		init_flags &= ~SDL_INIT_VIDEO;
+		init_flags |= SDL_INIT_EVENTS;
+	}
 #ifdef SDL_INIT_JOYSTICK
 	init_flags |= SDL_INIT_JOYSTICK;
 #endif
@@ -775,6 +781,11 @@ int DoInitializations(Uint32 video_flags)
 
 	/* Initialize the screen */
 	screen = new FrameBuf;
+	screen->SetOptions(screen->Options()|screen_options);
+	if ( screen->SetScale(screen_scale) < 0 ) {
+		error("Fatal: %s\n", screen->Error());
+		return(-1);
+	}
 	if (screen->Init(SCREEN_WIDTH, SCREEN_HEIGHT, video_flags,
 					colors[gGammaCorrect], icon) < 0){
 		error("Fatal: %s\n", screen->Error());
@@ -1011,6 +1022,10 @@ static int LoadBlits(Mac_Resource *spriteres)
 		return(-1);
 	DrawLoadBar(0);
 
+/* -- Build the spans for the last atlas page */
+
+	screen->FinishAtlas();
+
 	return(0);
 }	/* -- LoadBlits */
 
@@ -1049,11 +1064,43 @@ static void BackwardsSprite(BlitPtr *theBlit, BlitPtr oldBlit)
 	for (index = 0; index < aBlit->numFrames; index++) {
 		aBlit->sprite[index] = oldBlit->sprite[nFrames - index - 1];
 		aBlit->mask[index] = oldBlit->mask[nFrames - index - 1];
+		aBlit->bounds[index] = oldBlit->bounds[nFrames - index - 1];
 	}
 	(*theBlit) = aBlit;
 }	/* -- BackwardsSprite */
 
 
+/* ----------------------------------------------------------------- */
+/* -- Find the box around the pixels set in a frame's mask */
+
+static void MaskBounds(BlitPtr aBlit, int index, int size)
+{
+	int	top, left, bottom, right;
+	int	row, col;
+
+	/* An empty mask gets a box with nothing in it */
+	left = size;
+	right = -1;
+	top = size;
+	bottom = -1;
+	for ( row=0; row<size; ++row ) {
+		for ( col=0; col<size; ++col ) {
+			if ( MaskPixel(aBlit, index, col, row) ) {
+				if ( row < top )
+					top = row;
+				if ( row > bottom )
+					bottom = row;
+				if ( col < left )
+					left = col;
+				if ( col > right )
+					right = col;
+			}
+		}
+	}
+	SetRect(&aBlit->bounds[index], left, top, right, bottom);
+}	/* -- MaskBounds */
+
+
 /* ----------------------------------------------------------------- */
 /* -- Load in the sprites we use */
 
@@ -1122,20 +1169,23 @@ static int LoadSprite(Mac_Resource *spriteres,
 		SetRect(&aBlit->hitRect, left, top, right, bottom);
 				
 		/* Load the image */
-		aBlit->sprite[index] = screen->LoadImage(32, 32, S->data, mask);
-		if ( aBlit->sprite[index] == NULL ) {
+		if ( screen->AtlasImage(32, 32, S->data, mask,
+					&aBlit->sprite[index]) < 0 ) {
 			error(
 	"LoadSprite(%d+%d): Couldn't convert sprite image!\n", baseID, index);
 			return(-1);
 		}
 
-		/* Create the bytemask */
-		M->length = (M->length-128)*8;
-		aBlit->mask[index] = new Uint8[M->length];
-		for ( offset=0; offset<M->length; ++offset ) {
-			aBlit->mask[index][offset] = 
-				((mask[offset/8]>>(7-(offset%8)))&0x01);
+		/* Create the bitmask, a word for each row */
+		aBlit->mask[index].large = new Uint32[32];
+		for ( row=0; row<32; ++row ) {
+			aBlit->mask[index].large[row] =
+				((Uint32)mask[row*4+0] << 24) |
+				((Uint32)mask[row*4+1] << 16) |
+				((Uint32)mask[row*4+2] << 8) |
+				((Uint32)mask[row*4+3]);
 		}
+		MaskBounds(aBlit, index, 32);
 	}
 	(*theBlit) = aBlit;
 	return(0);
@@ -1242,20 +1292,21 @@ static int LoadSmallSprite(Mac_Resource *spriteres,
 		SetRect(&aBlit->hitRect, left, top, right, bottom);
 
 		/* Load the image */
-		aBlit->sprite[index] = screen->LoadImage(16, 16, S->data, mask);
-		if ( aBlit->sprite[index] == NULL ) {
+		if ( screen->AtlasImage(16, 16, S->data, mask,
+					&aBlit->sprite[index]) < 0 ) {
 			error(
 	"LoadSprite(%d+%d): Couldn't convert sprite image!\n", baseID, index);
 			return(-1);
 		}
 
-		/* Create the bytemask */
-		M->length = (M->length-32)*8;
-		aBlit->mask[index] = new Uint8[M->length];
-		for ( offset=0; offset<M->length; ++offset ) {
-			aBlit->mask[index][offset] = 
-				((mask[offset/8]>>(7-(offset%8)))&0x01);
+		/* Create the bitmask, a word for each row */
+		aBlit->mask[index].small = new Uint16[16];
+		for ( row=0; row<16; ++row ) {
+			aBlit->mask[index].small[row] =
+				((Uint16)mask[row*2+0] << 8) |
+				((Uint16)mask[row*2+1]);
 		}
+		MaskBounds(aBlit, index, 16);
 	}
 	(*theBlit) = aBlit;
 	return(0);
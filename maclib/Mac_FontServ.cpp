@@ -71,6 +71,11 @@ FontServ:: FontServ(const char *fontfile)
 {
 	fontres = new Mac_Resource(fontfile);
 	text_allocated = 0;
+	glyphsets = NULL;
+	memset(keyhash, 0, sizeof(keyhash));
+	memset(imagehash, 0, sizeof(imagehash));
+	lru_head = lru_tail = NULL;
+	memset(&cache_stats, 0, sizeof(cache_stats));
 	if ( fontres->Error() ) {
 		SetError("Couldn't load resources from %s", fontfile);
 		return;
@@ -84,11 +89,33 @@ FontServ:: FontServ(const char *fontfile)
 
 FontServ:: ~FontServ()
 {
+	FontGlyphs *glyphs;
+	TextEntry *entry;
+	int i;
+
 	if ( text_allocated != 0 ) {
 		fprintf(stderr,
 			"FontServ: Warning: %d text surfaces extant\n",
 							text_allocated);
 	}
+
+	while ( glyphsets ) {
+		glyphs = glyphsets;
+		glyphsets = glyphs->next;
+		delete[] glyphs->plain_pixels;
+		delete[] glyphs->bold_pixels;
+		delete glyphs;
+	}
+
+	/* The images themselves are freed with the pool */
+	for ( i = 0; i < TEXT_CACHE_BUCKETS; ++i ) {
+		while ( imagehash[i] ) {
+			entry = imagehash[i];
+			imagehash[i] = entry->imagenext;
+			delete[] entry->text;
+			delete entry;
+		}
+	}
 	delete fontres;
 }
 
@@ -199,6 +226,7 @@ FontServ:: NewFont(const char *fontname, int ptsize)
 		byteswap(font->locTable, nchars+1);
 		byteswap((Uint16 *)font->owTable, nchars);
 	}
+	font->glyphs = UnpackGlyphs(font);
 	return(font);
 }
 
@@ -206,40 +234,168 @@ FontServ:: NewFont(const char *fontname, int ptsize)
 #define HiByte(word)		((word>>8)&0xFF)
 #define LoByte(word)		(word&0xFF)
 
+/* Get bit i of a scan line */
+#define GETBIT(scanline, i) \
+		((scanline[(i)/16] >> (15 - (i)%16)) & 1)
+
+/* Unpack the glyphs of a font, once for all the fonts made from its data */
+FontGlyphs *
+FontServ:: UnpackGlyphs(MFont *font)
+{
+	FontGlyphs *glyphs;
+	FontGlyph *plain, *bold;
+	Uint16 *src_scanline;
+	Uint8 *row, *bold_row;
+	int nchars, ascii, c, y, bit;
+	int glyph_line_offset;	/* The offset into scanline of glyph */
+
+	for ( glyphs = glyphsets; glyphs; glyphs = glyphs->next ) {
+		if ( glyphs->nfnt == font->nfnt ) {
+			return(glyphs);
+		}
+	}
+
+	/* Notes on the tables.
+	
+	   Table 'bits' contains a bitmap image of the entire font.
+	   There are fRectHeight rows, each rowWords long.
+	   The high bit of a word is leftmost in the image.
+	   The characters are placed in this image in order of their
+	   ASCII value.  The last image is that of the "missing
+	   character"; every Mac font must have such an image
+	   (traditionally a maximum-sized block).
+	   
+	   The location table (loctab) and offset/width table (owtab)
+	   have one entry per character in the range firstChar..lastChar,
+	   plus two extra entries: one for the "missing character" image
+	   and a terminator.  They describe, respectively, where to
+	   find the character in the bitmap and how to interpret it with
+	   respect to the "character origin" (pen position on the base
+	   line).
+	   
+	   The location table entry for a character contains the bit (!)
+	   offset of the start of its image data in the font's bitmap.
+	   The image data's width is computed by subtracting the start
+	   from the start of the next character (hence the terminator).
+	   
+	   The offset/width table contains -1 for undefined characters;
+	   for defined characters, the high byte contains the character
+	   offset (distance between left of character image and
+	   character origin), and the low byte contains the character
+	   width (distance between the character origin and the origin
+	   of the next character on the line).
+	 */
+
+	glyphs = new FontGlyphs;
+	glyphs->nfnt = font->nfnt;
+	glyphs->height = (font->header)->fRectHeight;
+
+	/* Find the defined characters and lay out both atlases */
+	nchars = ((font->header)->lastChar - (font->header)->firstChar + 1) + 1;
+	glyphs->plain_pitch = 0;
+	glyphs->bold_pitch = 0;
+	for ( c = 0; c < 256; ++c ) {
+		/* According to the above comment, we should check if the
+		   table contains -1, but checking for <= 0 seems to fix a
+		   SIGSEGV that would otherwise occur in some cases.
+		 */
+		ascii = c - (font->header)->firstChar;
+		glyphs->defined[c] = ((c < nchars) &&
+				      (font->owTable[c] > 0) &&
+				      (ascii >= 0) && (ascii < nchars));
+		if ( ! glyphs->defined[c] ) {
+			continue;
+		}
+		plain = &glyphs->plain[c];
+		plain->x = glyphs->plain_pitch;
+		plain->w = (font->locTable[ascii+1] - font->locTable[ascii]);
+		plain->offset = HiByte(font->owTable[c]);
+		plain->advance = LoByte(font->owTable[c]);
+		glyphs->plain_pitch += plain->w;
+
+		bold = &glyphs->bold[c];
+		bold->x = glyphs->bold_pitch;
+		bold->w = plain->w+1;
+		bold->offset = plain->offset;
+#ifdef WIDE_BOLD
+		bold->advance = plain->advance+1;
+#else
+		bold->advance = plain->advance;
+#endif
+		glyphs->bold_pitch += bold->w;
+	}
+	glyphs->plain_pixels = new Uint8[glyphs->plain_pitch*glyphs->height];
+	memset(glyphs->plain_pixels, 0, glyphs->plain_pitch*glyphs->height);
+	glyphs->bold_pixels = new Uint8[glyphs->bold_pitch*glyphs->height];
+	memset(glyphs->bold_pixels, 0, glyphs->bold_pitch*glyphs->height);
+
+	/* Unpack the bits of each glyph, and smear them right for bold */
+	for ( c = 0; c < 256; ++c ) {
+		if ( ! glyphs->defined[c] ) {
+			continue;
+		}
+		plain = &glyphs->plain[c];
+		bold = &glyphs->bold[c];
+		ascii = c - (font->header)->firstChar;
+		glyph_line_offset = font->locTable[ascii];
+		for ( y = 0; y < glyphs->height; ++y ) {
+			src_scanline = font->bitImage +
+					y*(font->header)->rowWords;
+			row = glyphs->plain_pixels +
+					y*glyphs->plain_pitch + plain->x;
+			for ( bit = 0; bit < plain->w; ++bit ) {
+				row[bit] = GETBIT(src_scanline,
+						glyph_line_offset+bit);
+			}
+			bold_row = glyphs->bold_pixels +
+					y*glyphs->bold_pitch + bold->x;
+			for ( bit = 0; bit < plain->w; ++bit ) {
+				bold_row[bit] |= row[bit];
+				bold_row[bit+1] |= row[bit];
+			}
+		}
+	}
+
+	glyphs->next = glyphsets;
+	glyphsets = glyphs;
+	return(glyphs);
+}
+
+
 /* The width of the specified text in pixels when displayed with the 
    specified font and style.
 */
 Uint16
 FontServ:: TextWidth(const char *text, MFont *font, Uint8 style)
 {
-	int nchars, i;
-	int space_width;	/* The width of the whole character */
-	int extra_width;	/* Stylistic width */
+	const FontGlyph *table;
 	Uint16 Width;
+	TextEntry *entry;
+	int i;
+
+	/* Text drawn recently knows its width, whatever the colors */
+	entry = FindText(HashText(text, font, style), text, font, style,
+								NULL, NULL);
+	if ( entry ) {
+		return(entry->image->w);
+	}
 
 	switch (style) {
-		case STYLE_NORM:	extra_width = 0;
+		case STYLE_NORM:	table = font->glyphs->plain;
 					break;
-		case STYLE_BOLD:	extra_width = 1;
+		case STYLE_BOLD:	table = font->glyphs->bold;
 					break;
-		case STYLE_ULINE:	extra_width = 0;
+		case STYLE_ULINE:	table = font->glyphs->plain;
 					break;
 		default:		return(0);
 	}
-	nchars = strlen(text);
 
 	Width = 0;
-	for ( i = 0; i < nchars; ++i ) {
+	for ( i = 0; text[i]; ++i ) {
 		/* check to see if this character is defined */
-		if (font->owTable[(Uint8)text[i]] <= 0)
-			continue;
-		
-		space_width = LoByte(font->owTable[(Uint8)text[i]]);
-#ifdef WIDE_BOLD
-		Width += (space_width+extra_width);
-#else
-		Width += space_width;
-#endif
+		if ( font->glyphs->defined[(Uint8)text[i]] ) {
+			Width += table[(Uint8)text[i]].advance;
+		}
 	}
 	return(Width);
 }
@@ -249,35 +405,97 @@ FontServ:: TextHeight(MFont *font)
 	return((font->header)->fRectHeight);
 }
 
-/* Get/Set bit i of a scan line */
-#define GETBIT(scanline, i) \
-		((scanline[(i)/16] >> (15 - (i)%16)) & 1)
-#define SETBIT(scanline, i, bit) \
-		(scanline[(i)/8] |= bit << (7 - (i)%8))
-
 SDL_Surface *
 FontServ:: TextImage(const char *text, MFont *font, Uint8 style,
 			SDL_Color foreground, SDL_Color background)
+{
+	SDL_Surface *image;
+	TextEntry *entry;
+	Uint32 hash;
+
+	/* Share the image of the same text drawn recently */
+	hash = HashText(text, font, style);
+	entry = FindText(hash, text, font, style, &foreground, &background);
+	if ( entry ) {
+		if ( entry != lru_head ) {
+			entry->prev->next = entry->next;
+			if ( entry->next ) {
+				entry->next->prev = entry->prev;
+			} else {
+				lru_tail = entry->prev;
+			}
+			entry->prev = NULL;
+			entry->next = lru_head;
+			lru_head->prev = entry;
+			lru_head = entry;
+		}
+		++entry->users;
+		++cache_stats.hits;
+		++text_allocated;
+		return(entry->image);
+	}
+
+	image = RenderText(text, font, style, foreground, background);
+	if ( image ) {
+		++cache_stats.misses;
+		++text_allocated;
+		CacheText(image, hash, text, font, style,
+						foreground, background);
+		TrimCache();
+	}
+	return(image);
+}
+
+/* Get a text image from the pool, with just two colors to map when blitting */
+SDL_Surface *
+FontServ:: NewTextImage(Uint16 width, Uint16 height)
+{
+	SDL_Surface *image;
+	SDL_Palette *palette;
+
+	image = pool.Get(width, height, 8);
+	if ( image == NULL ) {
+		SetError("Unable to allocate bitmap: %s", SDL_GetError());
+		return(NULL);
+	}
+	if ( image->format->palette->ncolors != 2 ) {
+		palette = SDL_AllocPalette(2);
+		if ( palette == NULL ) {
+			SetError("Unable to allocate bitmap: %s", SDL_GetError());
+			pool.Put(image);
+			return(NULL);
+		}
+		SDL_SetSurfacePalette(image, palette);
+		SDL_FreePalette(palette);
+	}
+	return(image);
+}
+
+SDL_Surface *
+FontServ:: RenderText(const char *text, MFont *font, Uint8 style,
+			SDL_Color foreground, SDL_Color background)
 {
 	Uint16 width, height;
 	SDL_Surface *image;
-	Uint8 *bitmap;
-	int nchars;
-	int bit_offset;		/* The current bit offset into a scanline */
-	int space_width;	/* The width of the whole character */
-	int space_offset;	/* The offset into the character of glyph */
-	int glyph_line_offset;	/* The offset into scanline of glyph */
-	int glyph_width;	/* The width of brushed glyph */
-	int bold_offset, boldness;
-	int ascii, i, y;
-	int bit;
+	SDL_Color colors[2];
+	FontGlyphs *glyphs;
+	const FontGlyph *glyph, *table;
+	const Uint8 *atlas, *src;
+	Uint8 *dst;
+	int pitch, pen, x, w, y, i, c;
 
 	switch (style) {
-		case STYLE_NORM:	bold_offset = 0;
+		case STYLE_NORM:	table = font->glyphs->plain;
+					atlas = font->glyphs->plain_pixels;
+					pitch = font->glyphs->plain_pitch;
 					break;
-		case STYLE_BOLD:	bold_offset = 1;
+		case STYLE_BOLD:	table = font->glyphs->bold;
+					atlas = font->glyphs->bold_pixels;
+					pitch = font->glyphs->bold_pitch;
 					break;
-		case STYLE_ULINE:	bold_offset = 0;
+		case STYLE_ULINE:	table = font->glyphs->plain;
+					atlas = font->glyphs->plain_pixels;
+					pitch = font->glyphs->plain_pitch;
 					break;
 		case STYLE_ITALIC:	SetError(
 					"FontServ: Italics not implemented!");
@@ -286,128 +504,277 @@ FontServ:: TextImage(const char *text, MFont *font, Uint8 style,
 					"FontServ: Unknown text style!");
 					return(NULL);
 	}
+	glyphs = font->glyphs;
 
-	/* Notes on the tables.
-	
-	   Table 'bits' contains a bitmap image of the entire font.
-	   There are fRectHeight rows, each rowWords long.
-	   The high bit of a word is leftmost in the image.
-	   The characters are placed in this image in order of their
-	   ASCII value.  The last image is that of the "missing
-	   character"; every Mac font must have such an image
-	   (traditionally a maximum-sized block).
-	   
-	   The location table (loctab) and offset/width table (owtab)
-	   have one entry per character in the range firstChar..lastChar,
-	   plus two extra entries: one for the "missing character" image
-	   and a terminator.  They describe, respectively, where to
-	   find the character in the bitmap and how to interpret it with
-	   respect to the "character origin" (pen position on the base
-	   line).
-	   
-	   The location table entry for a character contains the bit (!)
-	   offset of the start of its image data in the font's bitmap.
-	   The image data's width is computed by subtracting the start
-	   from the start of the next character (hence the terminator).
-	   
-	   The offset/width table contains -1 for undefined characters;
-	   for defined characters, the high byte contains the character
-	   offset (distance between left of character image and
-	   character origin), and the low byte contains the character
-	   width (distance between the character origin and the origin
-	   of the next character on the line).
-	 */
-	
 	/* Figure out how big the text image will be */
 	width = TextWidth(text, font, style);
 	if ( width == 0 ) {
 		SetError("No text to convert");
 		return(NULL);
 	}
-	height = (font->header)->fRectHeight;
+	height = glyphs->height;
 
-	/* Allocate the text bitmap image */
-	image = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 1, 0,0,0,0);
+	/* Get a clear text image */
+	image = NewTextImage(width, height);
 	if ( image == NULL ) {
-		SetError("Unable to allocate bitmap: %s", SDL_GetError());
 		return(NULL);
 	}
-	bitmap = (Uint8 *)image->pixels;
-
-	/* Print the individual characters */
-	/* Note: this could probably be optimized.. eh, who cares. :) */
-	nchars = strlen(text);
-	for ( boldness=0; boldness <= bold_offset; ++boldness ) {
-		bit_offset=0;
-		for ( i = 0; i < nchars; ++i ) {
-			/* check to see if this character is defined */
-			/* According to the above comment, we should */
-			/* check if the table contains -1, but this  */
-			/* change seems to fix a SIGSEGV that would  */
-			/* otherwise occur in some cases.            */
-			if (font->owTable[(Uint8)text[i]] <= 0)
-				continue;
-
-			space_width = LoByte(font->owTable[(Uint8)text[i]]);
-			space_offset = HiByte(font->owTable[(Uint8)text[i]]);
-			ascii = (Uint8)text[i] - (font->header)->firstChar;
-			glyph_line_offset = font->locTable[ascii]; 
-			glyph_width = (font->locTable[ascii+1] -
-							font->locTable[ascii]);
-			for ( y=0; y<height; ++y ) {
-				int     dst_offset;
-				Uint16 *src_scanline;
-			
-				dst_offset = (y*image->pitch*8+
-						bit_offset+space_offset);
-				src_scanline = font->bitImage + 
-						y*(font->header)->rowWords;
-				for ( bit = 0; bit<glyph_width; ++bit ) {
-					SETBIT(bitmap, dst_offset+bit+boldness, 
-				  		GETBIT(src_scanline, glyph_line_offset+bit));
-				}
+	memset(image->pixels, 0, image->pitch*image->h);
+
+	/* Lay the glyphs out from the atlas, they may overlap */
+	pen = 0;
+	for ( i = 0; text[i]; ++i ) {
+		c = (Uint8)text[i];
+		if ( ! glyphs->defined[c] ) {
+			continue;
+		}
+		glyph = &table[c];
+		x = pen + glyph->offset;
+		w = SDL_min(glyph->w, width-x);
+		for ( y = 0; y < height; ++y ) {
+			src = atlas + y*pitch + glyph->x;
+			dst = (Uint8 *)image->pixels + y*image->pitch + x;
+			for ( c = 0; c < w; ++c ) {
+				dst[c] |= src[c];
 			}
-#ifdef WIDE_BOLD
-			bit_offset += (space_width+bold_offset);
-#else
-			bit_offset += space_width;
-#endif
 		}
+		pen += glyph->advance;
 	}
 	if ( (style&STYLE_ULINE) == STYLE_ULINE ) {
 		y = (height-(font->header)->descent+1);
-		bit_offset = (y*image->pitch*8);
-		for ( bit=0; bit<width; ++bit )
-			SETBIT(bitmap, bit_offset+bit, 0x01);
+		if ( y < height ) {
+			memset((Uint8 *)image->pixels + y*image->pitch, 1, width);
+		}
 	}
 
 	/* Map the image and return */
 	SDL_SetColorKey(image, SDL_TRUE, 0);
-	image->format->palette->colors[0] = background;
-	image->format->palette->colors[1] = foreground;
-	++text_allocated;
+	colors[0] = background;
+	colors[1] = foreground;
+	SDL_SetPaletteColors(image->format->palette, colors, 0, 2);
 	return(image);
 }
 void
 FontServ:: FreeText(SDL_Surface *text)
 {
+	TextEntry *entry;
+
 	--text_allocated;
-	SDL_FreeSurface(text);
+	entry = FindImage(text);
+	if ( entry == NULL ) {
+		if ( ! pool.Put(text) ) {
+			SDL_FreeSurface(text);
+		}
+		return;
+	}
+
+	/* Cached text stays around until it's evicted */
+	--entry->users;
+	if ( entry->cached ) {
+		TrimCache();
+	} else if ( entry->users == 0 ) {
+		ReleaseText(entry);
+	}
 }
 int
-FontServ:: InvertText(SDL_Surface *text)
+FontServ:: InvertText(SDL_Surface **image)
 {
+	SDL_Surface *text, *copy;
 	SDL_Color colors[2];
+	TextEntry *entry;
+	int y;
 
-	/* Only works on bitmap images */
-	if ( text->format->BitsPerPixel != 1 ) {
+	/* Only works on text images */
+	text = *image;
+	if ( (text->format->palette == NULL) ||
+	     (text->format->palette->ncolors != 2) ) {
 		SetError("Not a text bitmap");
 		return(-1);
 	}
 
+	/* Someone else is showing this image, so invert a copy of it */
+	entry = FindImage(text);
+	if ( entry && (entry->users > 1) ) {
+		copy = NewTextImage(text->w, text->h);
+		if ( copy == NULL ) {
+			return(-1);
+		}
+		for ( y = 0; y < text->h; ++y ) {
+			memcpy((Uint8 *)copy->pixels + y*copy->pitch,
+				(Uint8 *)text->pixels + y*text->pitch, text->w);
+		}
+		SDL_SetColorKey(copy, SDL_TRUE, 0);
+		SDL_SetPaletteColors(copy->format->palette,
+					text->format->palette->colors, 0, 2);
+		FreeText(text);
+		++text_allocated;
+		text = copy;
+		*image = copy;
+	} else if ( entry && entry->cached ) {
+		/* The next text like this one shouldn't be inverted */
+		UncacheText(entry);
+	}
+
 	/* Swap background and foreground colors */
 	colors[0] = text->format->palette->colors[1];
 	colors[1] = text->format->palette->colors[0];
 	SDL_SetPaletteColors(text->format->palette, colors, 0, 2);
 	return(0);
 }
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/* The text cache */
+
+static inline int SameColor(const SDL_Color *a, const SDL_Color *b)
+{
+	return((a->r == b->r) && (a->g == b->g) && (a->b == b->b));
+}
+
+Uint32
+FontServ:: HashText(const char *text, MFont *font, Uint8 style)
+{
+	Uint32 hash;
+
+	/* FNV-1a over the font, the style and the text */
+	hash = 2166136261u ^ (Uint32)(size_t)font->nfnt;
+	hash = (hash ^ style) * 16777619;
+	while ( *text ) {
+		hash = (hash ^ (Uint8)*text++) * 16777619;
+	}
+	return(hash);
+}
+
+FontServ::TextEntry *
+FontServ:: FindText(Uint32 hash, const char *text, MFont *font, Uint8 style,
+		const SDL_Color *foreground, const SDL_Color *background)
+{
+	TextEntry *entry;
+
+	for ( entry = keyhash[hash % TEXT_CACHE_BUCKETS]; entry;
+						entry = entry->keynext ) {
+		if ( (entry->hash == hash) && (entry->nfnt == font->nfnt) &&
+		     (entry->style == style) &&
+		     (strcmp(entry->text, text) == 0) &&
+		     (!foreground || SameColor(&entry->foreground, foreground)) &&
+		     (!background || SameColor(&entry->background, background)) ) {
+			return(entry);
+		}
+	}
+	return(NULL);
+}
+
+FontServ::TextEntry *
+FontServ:: FindImage(SDL_Surface *image)
+{
+	TextEntry *entry;
+
+	for ( entry = imagehash[ImageBucket(image)]; entry;
+						entry = entry->imagenext ) {
+		if ( entry->image == image ) {
+			return(entry);
+		}
+	}
+	return(NULL);
+}
+
+void
+FontServ:: CacheText(SDL_Surface *image, Uint32 hash, const char *text,
+		MFont *font, Uint8 style,
+		SDL_Color foreground, SDL_Color background)
+{
+	TextEntry *entry;
+	int bucket;
+
+	entry = new TextEntry;
+	entry->nfnt = font->nfnt;
+	entry->style = style;
+	entry->foreground = foreground;
+	entry->background = background;
+	entry->text = new char[strlen(text)+1];
+	strcpy(entry->text, text);
+	entry->hash = hash;
+	entry->image = image;
+	entry->users = 1;
+	entry->cached = 1;
+
+	bucket = hash % TEXT_CACHE_BUCKETS;
+	entry->keynext = keyhash[bucket];
+	keyhash[bucket] = entry;
+	bucket = ImageBucket(image);
+	entry->imagenext = imagehash[bucket];
+	imagehash[bucket] = entry;
+	entry->prev = NULL;
+	entry->next = lru_head;
+	if ( lru_head ) {
+		lru_head->prev = entry;
+	} else {
+		lru_tail = entry;
+	}
+	lru_head = entry;
+
+	++cache_stats.entries;
+	cache_stats.bytes += image->pitch*image->h;
+}
+
+/* Take text out of the cache, it's freed when its last user is done */
+void
+FontServ:: UncacheText(TextEntry *entry)
+{
+	TextEntry **prev;
+
+	for ( prev = &keyhash[entry->hash % TEXT_CACHE_BUCKETS];
+				*prev != entry; prev = &(*prev)->keynext )
+		;
+	*prev = entry->keynext;
+	if ( entry->prev ) {
+		entry->prev->next = entry->next;
+	} else {
+		lru_head = entry->next;
+	}
+	if ( entry->next ) {
+		entry->next->prev = entry->prev;
+	} else {
+		lru_tail = entry->prev;
+	}
+	entry->cached = 0;
+
+	--cache_stats.entries;
+	cache_stats.bytes -= entry->image->pitch*entry->image->h;
+}
+
+void
+FontServ:: ReleaseText(TextEntry *entry)
+{
+	TextEntry **prev;
+
+	if ( entry->cached ) {
+		UncacheText(entry);
+	}
+	for ( prev = &imagehash[ImageBucket(entry->image)];
+				*prev != entry; prev = &(*prev)->imagenext )
+		;
+	*prev = entry->imagenext;
+	pool.Put(entry->image);
+	delete[] entry->text;
+	delete entry;
+}
+
+/* Evict the least recently used text nobody is using, until the cache
+   is back within its limits
+ */
+void
+FontServ:: TrimCache(void)
+{
+	TextEntry *entry, *prev;
+
+	entry = lru_tail;
+	while ( entry && ((cache_stats.entries > TEXT_CACHE_ENTRIES) ||
+			  (cache_stats.bytes > TEXT_CACHE_BYTES)) ) {
+		prev = entry->prev;
+		if ( entry->users == 0 ) {
+			ReleaseText(entry);
+			++cache_stats.evictions;
+		}
+		entry = prev;
+	}
+}
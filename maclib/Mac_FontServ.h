@@ -37,6 +37,7 @@
 
 #include "Mac_Resource.h"
 #include "SDL_FrameBuf.h"
+#include "pool.h"
 
 /* Different styles supported by the font server */
 #define STYLE_NORM	0x00
@@ -46,6 +47,19 @@
 
 #define WIDE_BOLD	/* Bold text is widened porportionally */
 
+/* Recently drawn text is kept, up to these limits on the text not in use */
+#define TEXT_CACHE_ENTRIES	256
+#define TEXT_CACHE_BYTES	(256*1024)
+#define TEXT_CACHE_BUCKETS	64
+
+typedef struct {
+	Uint32 hits;		/* Text images reused from the cache */
+	Uint32 misses;		/* Text images drawn */
+	Uint32 evictions;	/* Cached text images released */
+	Uint32 entries;		/* Text images in the cache */
+	Uint32 bytes;		/* Pixels of the text images in the cache */
+} TextCacheStats;
+
 /* Macintosh font magic numbers */
 #define PROPFONT	0x9000
 #define FIXEDFONT	0xB000
@@ -68,6 +82,29 @@ struct FontHdr {
                rowWords;        /* Row width of bit image in words */
 };
 
+/* The glyphs of a font unpacked to a byte per pixel, side by side in an
+   atlas as tall as the font, with the bold glyphs in a second atlas.
+   A bold glyph is the plain one with a copy one pixel to the right.
+ */
+typedef struct {
+	Uint16 x;		/* The column of the glyph in the atlas */
+	Uint16 w;		/* The width of the glyph image */
+	Uint16 offset;		/* From the pen position to the image */
+	Uint16 advance;		/* From the pen position to the next one */
+} FontGlyph;
+
+typedef struct FontGlyphs {
+	Mac_ResData *nfnt;	/* The font these are for */
+	int height;
+	int defined[256];
+	FontGlyph plain[256];
+	FontGlyph bold[256];
+	int plain_pitch, bold_pitch;
+	Uint8 *plain_pixels;	/* 1 where the glyph is drawn */
+	Uint8 *bold_pixels;
+	struct FontGlyphs *next;
+} FontGlyphs;
+
 typedef struct {
 	struct FontHdr *header;		/* The NFNT header! */
 
@@ -78,6 +115,9 @@ typedef struct {
 
 	/* The Raw Data */
 	Mac_ResData *nfnt;
+
+	/* The unpacked glyphs, shared by the fonts made from the same data */
+	FontGlyphs *glyphs;
 } MFont;
 
 class FontServ {
@@ -96,8 +136,13 @@ public:
 	Uint16	TextWidth(const char *text, MFont *font, Uint8 style);
 	Uint16	TextHeight(MFont *font);
 
-	/* Returns a bitmap image filled with the requested text.
+	/* Returns an 8-bit image of the requested text, with a palette of
+	   the background color and the foreground color.
 	   The text should be freed with FreeText() after it is used.
+	   Text drawn recently in the same font, style and colors returns
+	   the same image, so the image must not be changed, except with
+	   InvertText().  Images dropped from the cache go back to a pool,
+	   for the next text of the same size.
 	 */
 	SDL_Surface *TextImage(const char *text, MFont *font, Uint8 style,
 				SDL_Color background, SDL_Color foreground);
@@ -112,9 +157,18 @@ public:
 		return(TextImage(text, font, style, foreground, background));
 	}
 	void FreeText(SDL_Surface *text);
+	const SurfacePoolStats *TextStats(void) {
+		return(pool.Stats());
+	}
+	const TextCacheStats *CacheStats(void) {
+		return(&cache_stats);
+	}
 
-	/* Inverts the color of the text image */
-	int InvertText(SDL_Surface *text);
+	/* Inverts the color of the text image, it's taken out of the cache.
+	   If the same image was given out for other text, it's freed and
+	   replaced with an inverted copy.
+	 */
+	int InvertText(SDL_Surface **text);
 
 	/* Returns NULL if everything is okay, or an error message if not */
 	char *Error(void) {
@@ -124,6 +178,51 @@ public:
 private:
 	Mac_Resource *fontres;
 	int text_allocated;
+	SurfacePool pool;
+
+	SDL_Surface *NewTextImage(Uint16 width, Uint16 height);
+	SDL_Surface *RenderText(const char *text, MFont *font, Uint8 style,
+				SDL_Color foreground, SDL_Color background);
+
+	/* The glyphs of every font made so far */
+	FontGlyphs *glyphsets;
+	FontGlyphs *UnpackGlyphs(MFont *font);
+
+	/* The text cache, hashed by what was drawn and by the image.
+	   The font is known by its NFNT resource, which lasts as long as
+	   the font server, while fonts are made and deleted all the time.
+	 */
+	typedef struct TextEntry {
+		Mac_ResData *nfnt;
+		Uint8 style;
+		SDL_Color foreground, background;
+		char *text;
+		Uint32 hash;
+		SDL_Surface *image;
+		int users;		/* TextImage() calls not freed yet */
+		int cached;		/* Cleared by InvertText() */
+		struct TextEntry *prev, *next;	/* Most recently used first */
+		struct TextEntry *keynext;
+		struct TextEntry *imagenext;
+	} TextEntry;
+	TextEntry *keyhash[TEXT_CACHE_BUCKETS];
+	TextEntry *imagehash[TEXT_CACHE_BUCKETS];
+	TextEntry *lru_head, *lru_tail;
+	TextCacheStats cache_stats;
+	static Uint32 HashText(const char *text, MFont *font, Uint8 style);
+	static int ImageBucket(SDL_Surface *image) {
+		return((int)(((size_t)image >> 4) % TEXT_CACHE_BUCKETS));
+	}
+	TextEntry *FindText(Uint32 hash, const char *text, MFont *font,
+		Uint8 style, const SDL_Color *foreground,
+					const SDL_Color *background);
+	TextEntry *FindImage(SDL_Surface *image);
+	void CacheText(SDL_Surface *image, Uint32 hash, const char *text,
+		MFont *font, Uint8 style,
+		SDL_Color foreground, SDL_Color background);
+	void UncacheText(TextEntry *entry);
+	void ReleaseText(TextEntry *entry);
+	void TrimCache(void);
 
 	/* Useful for getting error feedback */
 	void SetError(const char *fmt, ...) {
@@ -17,7 +17,9 @@
 #include "checksum.h"
 
 /* External functions used in this file */
-extern int DoInitializations(Uint32 video_flags);		/* init.cc */
+extern int DoInitializations(Uint32 video_flags, Uint32 screen_options,
+					int screen_scale);	/* init.cc */
+extern int RunSpeedTest(const char *which);			/* speedtest.cc */
 
 static const char *Version =
 "Maelstrom v1.4.3 (GPL version 3.0.7) -- 02/01/2021 by Sam Lantinga\n";
@@ -28,6 +30,7 @@ int	gStartLevel;
 Bool	gUpdateBuffer;
 Bool	gRunning;
 int	gNoDelay;
+int	gRefreshRate;
 
 // Local variables in this file...
 static ButtonList buttons;
@@ -115,33 +118,6 @@ static void RunZapScores(void)
 	}
 }
 
-/* ----------------------------------------------------------------- */
-/* -- Run a graphics speed test.                                     */
-static void RunSpeedTest(void)
-{
-	const int test_reps = 100;	/* How many full cycles to run */
-
-	Uint32 then, now;
-	int i, frame, x=((640/2)-16), y=((480/2)-16), onscreen=0;
-
-	screen->Clear();
-	then = SDL_GetTicks();
-	for ( i=0; i<test_reps; ++i ) {
-		for ( frame=0; frame<SHIP_FRAMES; ++frame ) {
-			if ( onscreen ) {
-				screen->Clear(x, y, 32, 32);
-			} else {
-				onscreen = 1;
-			}
-			screen->QueueBlit(x, y, gPlayerShip->sprite[frame]);
-			screen->Update();
-		}
-	}
-	now = SDL_GetTicks();
-	mesg("Graphics speed test took %d microseconds per cycle.\r\n",
-						((now-then)/test_reps));
-}
-
 /* ----------------------------------------------------------------- */
 /* -- Print a Usage message and quit.
       In several places we depend on this function exiting.
@@ -154,6 +130,12 @@ void PrintUsage(void)
 	error("Usage: %s <options>\n\n", progname);
 	error("Where <options> can be any of:\n\n"
 "	-windowed		# Run Maelstrom in windowed mode\n"
+"	-renderthread		# Convert the screen in a separate thread\n"
+"	-bandconvert		# Convert full screen updates with threads\n"
+"	-headless		# Draw without a display, for -speedtest\n"
+"	-native32		# Draw in 32-bit color, not converted\n"
+"	-interpolate [Hz]	# Draw frames between the game's time steps\n"
+"	-scale [0-4]		# Scale the screen up, 0 fits the display\n"
 "	-gamma [0-8]		# Set the gamma correction\n"
 "	-volume [0-8]		# Set the sound volume\n"
 "	-netscores		# Use the world-wide network score server\n"
@@ -170,7 +152,10 @@ int main(int argc, char *argv[])
 	/* Command line flags */
 	int doprinthigh = 0;
 	int speedtest = 0;
+	const char *speedtest_name = NULL;
 	Uint32 video_flags = SDL_WINDOW_FULLSCREEN_DESKTOP;
+	Uint32 screen_options = 0;
+	int screen_scale = 1;
 
 	/* Normal variables */
 	SDL_Event event;
@@ -196,6 +181,48 @@ int main(int argc, char *argv[])
 		if ( strcmp(argv[1], "-windowed") == 0 ) {
 			video_flags &= ~SDL_WINDOW_FULLSCREEN_DESKTOP;
 		} else
+		if ( strcmp(argv[1], "-renderthread") == 0 ) {
+			screen_options |= FRAMEBUF_RENDERTHREAD;
+		} else
+		if ( strcmp(argv[1], "-bandconvert") == 0 ) {
+			screen_options |= FRAMEBUF_BANDCONVERT;
+		} else
+		if ( strcmp(argv[1], "-headless") == 0 ) {
+			screen_options |= FRAMEBUF_HEADLESS;
+		} else
+		if ( strcmp(argv[1], "-native32") == 0 ) {
+			screen_options |= FRAMEBUF_NATIVE32;
+		} else
+		if ( strcmp(argv[1], "-interpolate") == 0 ) {
+			gRefreshRate = -1;
+
+			/* An optional rate, otherwise the display's */
+			if ( argv[2] && (argv[2][0] != '-') ) {
+				gRefreshRate = atoi(argv[2]);
+				if ( (gRefreshRate < 60) || (gRefreshRate > 360) ) {
+					error(
+	"Refresh rate must be a number between 60 and 360. -- Exiting.\n");
+					exit(1);
+				}
+				++argv;
+				--argc;
+			}
+		} else
+		if ( strcmp(argv[1], "-scale") == 0 ) {
+			screen_scale = 0;
+
+			/* An optional scale, otherwise it fits the display */
+			if ( argv[2] && (argv[2][0] != '-') ) {
+				screen_scale = atoi(argv[2]);
+				if ( (screen_scale < 0) || (screen_scale > 4) ) {
+					error(
+	"Scale must be a number between 0 and 4. -- Exiting.\n");
+					exit(1);
+				}
+				++argv;
+				--argc;
+			}
+		} else
 		if ( strcmp(argv[1], "-gamma") == 0 ) {
 			int gammacorrect;
 
@@ -248,8 +275,16 @@ int main(int argc, char *argv[])
 			doprinthigh = 1;
 		else if ( strcmp(argv[1], "-netscores") == 0 )
 			gNetScores = 1;
-		else if ( strcmp(argv[1], "-speedtest") == 0 )
+		else if ( strcmp(argv[1], "-speedtest") == 0 ) {
 			speedtest = 1;
+
+			/* An optional test name runs just that test */
+			if ( argv[2] && (argv[2][0] != '-') ) {
+				speedtest_name = argv[2];
+				++argv;
+				--argc;
+			}
+		}
 		else if ( LogicParseArgs(&argv, &argc) == 0 ) {
 			/* LogicParseArgs() took care of everything */;
 		} else if ( strcmp(argv[1], "-version") == 0 ) {
@@ -273,14 +308,17 @@ int main(int argc, char *argv[])
 		exit(1);
 
 	/* Initialize everything. :) */
-	if ( DoInitializations(video_flags) < 0 ) {
+	if ( DoInitializations(video_flags, screen_options,
+							screen_scale) < 0 ) {
 		/* An error message was already printed */
 		exit(1);
 	}
+	if ( gRefreshRate < 0 ) {
+		gRefreshRate = screen->RefreshRate();
+	}
 
 	if ( speedtest ) {
-		RunSpeedTest();
-		exit(0);
+		exit(RunSpeedTest(speedtest_name) < 0 ? 1 : 0);
 	}
 
 	gRunning = true;
@@ -30,10 +30,10 @@ void DoAbout(void)
 		int    sound_to_play = 0;
 
 		/* Rotate any sprites */
+		screen->StartSprites();
 		for ( i=0; i<numsprites; ++i ) {
-			objects[i]->UnBlitSprite();
 			objects[i]->Move(0);
-			objects[i]->BlitSprite();
+			objects[i]->BlitSprite(BLEND_ONE);
 		}
 		screen->Update();
 
@@ -77,6 +77,9 @@ void DoAbout(void)
 			int   xOff,  yOff;
 
 			screen->Fade();
+
+			/* -- The page is the background the sprites move on */
+			screen->FocusBG();
 			screen->Clear();
 
 			/* -- Draw the screen frame */
@@ -102,7 +105,6 @@ void DoAbout(void)
                			exit(255);
 			}
 			screen->QueueBlit(xOff, yOff, title, NOCLIP);
-			screen->Update();
 			screen->FreeImage(title);
 
 			/* Draw color icons if this is Game screen */
@@ -195,10 +197,18 @@ void DoAbout(void)
 				delete font;
 			}
 			screen->Update();
+			screen->FocusFG();
+			screen->Clear();
+			screen->Update();
 			screen->Fade();
 			drawscreen = false;
 		}
 	}
 	screen->Fade();
+
+	/* -- The other screens are drawn over a clear background */
+	screen->FocusBG();
+	screen->Clear();
+	screen->FocusFG();
 	gUpdateBuffer = true;
 }	/* -- DoAbout */
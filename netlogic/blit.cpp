@@ -2,7 +2,6 @@
 /* Note well:  The order that things are done is very important to prevent
                bugs.  Several optimizing assumptions are done in player.cc
                and object.cc that require this order.  For example, I assume
-               that all sprites are erased when object->Move() is called,
                that object->HitBy() is called before the move, and that
                object->Move() is called EVERY timestep!
 */
@@ -13,6 +12,65 @@
 #include "player.h"
 #include "globals.h"
 
+/* The areas the ship being checked for hits can hit things with */
+static HitGrid hitgrid;
+
+/* Draw the sprites 'frac' of the way through the last time step */
+static void DrawSprites(int frac)
+{
+	int i;
+
+	/* Replace the last frame's sprites */
+	screen->StartSprites();
+	OBJ_LOOP(i, gNumSprites)
+		gSprites[i]->BlitSprite(frac);
+	OBJ_LOOP(i, gNumPlayers)
+		gPlayers[i]->BlitSprite(frac);
+	screen->Update();
+
+	if ( gNumPlayers > 1 ) {
+		OBJ_LOOP(i, gNumPlayers)
+			gPlayers[i]->ShowDot(frac);
+		screen->Update();
+	}
+}
+
+/* Until the next time step is due, draw frames at gRefreshRate with the
+   sprites on their way from the last time step, skipping the frames that
+   wouldn't be done in time.  The game itself isn't touched.
+*/
+static void InterpolateFrames(void)
+{
+	Uint32 start, end, now, next, period, cost;
+	int frac;
+
+	/* The time step began, and ends, when Ticks reached those times */
+	start = ((gLastDrawn*1000)+59)/60;
+	end = (((gLastDrawn+FRAME_DELAY)*1000)+59)/60;
+	period = 1000/gRefreshRate;
+	cost = 0;
+	next = SDL_GetTicks()+period;
+	while ( ((now=SDL_GetTicks())+cost) < end ) {
+		if ( now < next ) {
+			SDL_Delay(1);
+			continue;
+		}
+		frac = ((now-start)*BLEND_ONE)/(end-start);
+		if ( frac > BLEND_ONE )
+			frac = BLEND_ONE;
+
+		screen->BeginFrame();
+		DrawSprites(frac);
+		screen->EndFrame();
+
+		/* Don't catch up on frames we were too late for */
+		cost = SDL_GetTicks()-now;
+		next += period;
+		if ( next <= now )
+			next = now+period;
+	}
+}
+
 /* Returns the number of players left in the game */
 int RunFrame(void)
 {
@@ -24,13 +82,19 @@ int RunFrame(void)
 	/* Send Sync! signal to all players, and handle keyboard. */
 	if ( SyncNetwork() < 0 ) {
 		error("Game aborted!\n");
+		screen->EndFrame();
 		return(0);
 	}
 	OBJ_LOOP(i, gNumPlayers)
 		gPlayers[i]->HandleKeys();
 
-	if ( gPaused > 0 )
+	if ( gPaused > 0 ) {
+		screen->EndFrame();
 		return(1);
+	}
+
+	/* Everything drawn from here on is presented once, at the end */
+	screen->BeginFrame();
 
 	/* Play the boom sounds */
 	if ( --gNextBoom == 0 ) {
@@ -44,16 +108,14 @@ int RunFrame(void)
 		gNextBoom = gBoomDelay;
 	}
 
-	/* UnBlit all of the sprites and players */
-	OBJ_LOOP(i, gNumPlayers)
-		gPlayers[i]->UnBlitSprite();
-	OBJ_LOOP(i, gNumSprites)
-		gSprites[i]->UnBlitSprite();
-
-	/* Do all hit detection */
+	/* Do all hit detection, skipping the objects out of the reach of
+	   each ship, so the hits happen exactly as if all were checked.
+	 */
 	OBJ_LOOP(j, gNumPlayers) {
 		if ( ! gPlayers[j]->Alive() )
 			continue;
+		hitgrid.Clear();
+		gPlayers[j]->MarkHits(&hitgrid);
 
 		/* This loop looks funny because gNumSprites can change 
 		   dynamically during the loop as sprites are killed/created.
@@ -61,6 +123,8 @@ int RunFrame(void)
 		   might be destroyed.
 		*/
 		OBJ_LOOP(i, gNumSprites) {
+			if ( ! gSprites[i]->InReach(&hitgrid) )
+				continue;
 			if ( gSprites[i]->HitBy(gPlayers[j]) < 0 ) {
 				delete gSprites[i];
 				gSprites[i] = gSprites[gNumSprites];
@@ -69,18 +133,26 @@ int RunFrame(void)
 		OBJ_LOOP(i, gNumPlayers) {
 			if ( i == j )	// Don't shoot ourselves. :)
 				continue;
+			if ( ! gPlayers[i]->InReach(&hitgrid) )
+				continue;
 			(void) gPlayers[i]->HitBy(gPlayers[j]);
 		}
 	}
 	if ( gEnemySprite ) {
+		hitgrid.Clear();
+		gEnemySprite->MarkHits(&hitgrid);
 		OBJ_LOOP(i, gNumPlayers) {
 			if ( ! gPlayers[i]->Alive() )
 				continue;
+			if ( ! gPlayers[i]->InReach(&hitgrid) )
+				continue;
 			(void) gPlayers[i]->HitBy(gEnemySprite);
 		}
 		OBJ_LOOP(i, gNumSprites) {
 			if ( gSprites[i] == gEnemySprite )
 				continue;
+			if ( ! gSprites[i]->InReach(&hitgrid) )
+				continue;
 			if ( gSprites[i]->HitBy(gEnemySprite) < 0 ) {
 				delete gSprites[i];
 				gSprites[i] = gSprites[gNumSprites];
@@ -104,11 +176,12 @@ int RunFrame(void)
 		}
 	}
 
-	/* Move all of the sprites */
+	/* Move all of the sprites, the ones that coast all at once */
 	OBJ_LOOP(i, gNumPlayers)
 		gPlayers[i]->Move(0);
+	gMotion.Coast(gFreezeTime);
 	OBJ_LOOP(i, gNumSprites) {
-		if ( gSprites[i]->Move(gFreezeTime) < 0 ) {
+		if ( gSprites[i]->Step(gFreezeTime) < 0 ) {
 			delete gSprites[i];
 			gSprites[i] = gSprites[gNumSprites];
 		}
@@ -116,23 +189,19 @@ int RunFrame(void)
 	if ( gFreezeTime )
 		--gFreezeTime;
 
-	/* Now Blit them all again */
-	OBJ_LOOP(i, gNumSprites)
-		gSprites[i]->BlitSprite();
-	OBJ_LOOP(i, gNumPlayers)
-		gPlayers[i]->BlitSprite();
-	screen->Update();
+	/* Now Blit them all again, where they were if the frames in
+	   between time steps take them from there to where they are now.
+	 */
+	if ( gRefreshRate && ! gNoDelay )
+		DrawSprites(0);
+	else
+		DrawSprites(BLEND_ONE);
 
 	/* Make sure someone is still playing... */
 	for ( i=0, PlayersLeft=0; i < gNumPlayers; ++i ) {
 		if ( gPlayers[i]->Kicking() )
 			++PlayersLeft;
 	}
-	if ( gNumPlayers > 1 ) {
-		OBJ_LOOP(i, gNumPlayers)
-			gPlayers[i]->ShowDot();
-		screen->Update();
-	}
 
 #ifdef SERIOUS_DEBUG
 printf("Player listing: ");
@@ -153,9 +222,11 @@ printf("\n");
 #endif /* SERIOUS_DEBUG */
 
 	/* Timing handling -- Delay the FRAME_DELAY */
-	screen->Update();
+	screen->EndFrame();
 	if ( ! gNoDelay ) {
 		Uint32 ticks;
+		if ( gRefreshRate )
+			InterpolateFrames();
 		while ( ((ticks=Ticks)-gLastDrawn) < FRAME_DELAY ) {
 			SDL_Delay(1);
 		}
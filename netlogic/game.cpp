@@ -5,90 +5,9 @@
 #include "netplay.h"
 #include "make.h"
 #include "load.h"
+#include "status.h"
 
 
-#ifdef MOVIE_SUPPORT
-extern int gMovie;
-static SDL_Rect gMovieRect;
-int SelectMovieRect(void)
-{
-	SDL_Event event;
-	SDL_Surface *saved;
-	Uint32 white;
-	int center_x, center_y;
-	int width, height;
-
-	/* Wait for initial button press */
-	screen->ShowCursor();
-	center_x = 0;
-	center_y = 0;
-	while ( ! center_x && ! center_y ) {
-		screen->WaitEvent(&event);
-
-		/* Check for escape key */
-		if ( (event.type == SDL_KEYEVENT) && 
-				(event.key.state == SDL_PRESSED) &&
-				(event.key.keysym.sym == SDL_ESCAPE) ) {
-			screen->HideCursor();
-			return(0);
-		}
-
-		/* Wait for button press */
-		if ( (event.type == SDL_MOUSEBUTTONEVENT) && 
-				(event.button.state == SDL_PRESSED) ) {
-			center_x = event.button.x;
-			center_y = event.button.y;
-			break;
-		}
-	}
-
-	/* Save the screen */
-	white = screen->MapRGB(0xFFFF, 0xFFFF, 0xFFFF);
-	saved = screen->GrabArea(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-
-	/* As the box moves... */
-	width = height = 0;
-	while ( 1 ) {
-		win->GetEvent(&event);
-
-		/* Check for escape key */
-		if ( (event.type == SDL_KEYEVENT) && 
-				(event.key.state == SDL_PRESSED) &&
-				(event.key.keysym.sym == SDL_ESCAPE) ) {
-			screen->QueueBlit(0, 0, saved, NOCLIP);
-			screen->Update();
-			screen->FreeImage(saved);
-			win->HideCursor();
-			return(0);
-		}
-
-		/* Check for ending button press */
-		if ( event.type == ButtonPress ) {
-			gMovieRect.x = center_x - width;
-			gMovieRect.y = center_y - height;
-			gMovieRect.w = 2*width;
-			gMovieRect.h = 2*height;
-			screen->QueueBlit(0, 0, saved, NOCLIP);
-			screen->Update();
-			screen->FreeImage(saved);
-			win->HideCursor();
-			return(1);
-		}
-
-		if ( event.type == MotionNotify ) {
-			screen->QueueBlit(0, 0, saved, NOCLIP);
-			screen->Update();
-			width = abs(event.motion.x - center_x);
-			height = abs(event.motion.y - center_y);
-			screen->DrawRect(center_x-width, center_y-height,
-						2*width, 2*height, white);
-			screen->Update();
-		}
-	}
-	/* NEVERREACHED */
-
-}
-#endif
 extern int RunFrame(void);	/* The heart of blit.cc */
 
 // Global variables set in this file...
@@ -120,248 +39,145 @@ static MFont *geneva=NULL;
 static Uint32 ourGrey, ourWhite, ourBlack;
 static int text_height;
 
+/* The status display, and the ids of the widgets that change */
+static StatusLine *status = NULL;
+static struct {
+	int score, shield, wave, lives, bonus, frags;
+	int mult, specials[5];
+	int caption, color;
+} hud;
+
 // Local functions used in the game module of Maelstrom
 static void DoHouseKeeping(void);
 static void NextWave(void);
 static void DoGameOver(void);
 static void DoBonus(void);
 static void TwinkleStars(void);
+static void NewStatus(void);
+
+/* ----------------------------------------------------------------- */
+/* -- Lay out the status display */
+
+static void NewStatus(void)
+{
+	static const struct {
+		unsigned char special;
+		SDL_Surface **icon;
+		int x;
+	} specials[] = {
+		{ MACHINE_GUNS,	&gAutoFireIcon,		438 },
+		{ AIR_BRAKES,	&gAirBrakesIcon,	454 },
+		{ LUCKY_IRISH,	&gLuckOfTheIrishIcon,	470 },
+		{ TRIPLE_FIRE,	&gTripleFireIcon,	486 },
+		{ LONG_RANGE,	&gLongFireIcon,		502 },
+	};
+	SDL_Surface *icons[6];
+	char caption[BUFSIZ];
+	int i, x;
+
+	status = new StatusLine(geneva, STYLE_BOLD, ourBlack);
+
+	/* -- The line above the status display, and the labels */
+	i = status->AddSwatch(0, gStatusLine, SCREEN_WIDTH, 1);
+	status->Set(i, ourWhite);
+	x = 3;
+	i = status->AddLabel(x, gStatusLine+11, "Score:",
+					30000>>8, 30000>>8, 0xFF);
+	x += (status->Width(i)+70);
+	i = status->AddLabel(x, gStatusLine+11, "Shield:",
+					30000>>8, 30000>>8, 0xFF);
+	x += (status->Width(i)+70);
+	i = status->AddLabel(x, gStatusLine+11, "Wave:",
+					30000>>8, 30000>>8, 0xFF);
+	x += (status->Width(i)+30);
+	i = status->AddLabel(x, gStatusLine+11, "Lives:",
+					30000>>8, 30000>>8, 0xFF);
+	x += (status->Width(i)+30);
+	status->AddLabel(x, gStatusLine+11, "Bonus:",
+					30000>>8, 30000>>8, 0xFF);
+
+	/* -- The values */
+	hud.score = status->AddNumber(45, gStatusLine+11, "%d",
+							0xFF, 0xFF, 0xFF);
+	hud.shield = status->AddBar(152, gStatusLine+4, SHIELD_WIDTH, 8,
+					MAX_SHIELD, ourWhite, ourGrey);
+	hud.wave = status->AddNumber(255, gStatusLine+11, "%d",
+							0xFF, 0xFF, 0xFF);
+	hud.lives = status->AddNumber(319, gStatusLine+11, "%-3.1d",
+							0xFF, 0xFF, 0xFF);
+	hud.bonus = status->AddNumber(384, gStatusLine+11, "%-7.1d",
+							0xFF, 0xFF, 0xFF);
+	icons[0] = NULL;
+	icons[1] = NULL;
+	icons[2] = gMult2Icon;
+	icons[3] = gMult3Icon;
+	icons[4] = gMult4Icon;
+	icons[5] = gMult5Icon;
+	hud.mult = status->AddIcons(424, gStatusLine+4, 8, 8, icons, 6);
+	for ( i=0; i<(int)SDL_arraysize(specials); ++i ) {
+		icons[1] = *specials[i].icon;
+		hud.specials[i] = status->AddIcons(specials[i].x,
+					gStatusLine+4, 8, 8, icons, 2);
+	}
+
+	if ( gNumPlayers > 1 ) {
+		/* Heh, DOOM style frag count */
+		x = 530;
+		i = status->AddLabel(x, gStatusLine+11, "Frags:",
+					30000>>8, 30000>>8, 0xFF);
+		hud.frags = status->AddNumber(x+status->Width(i)+4,
+				gStatusLine+11, "%-3.1d", 0xFF, 0xFF, 0xFF);
+
+		/* Who we're watching, and their color */
+		SDL_snprintf(caption, sizeof(caption),
+			"You are player %d --- displaying player %%d",
+							gOurPlayer+1);
+		hud.caption = status->AddNumber(SPRITES_WIDTH, 11, caption,
+					30000>>8, 30000>>8, 0xFF);
+		hud.color = status->AddSwatch(518, gStatusLine+4, 4, 8);
+	} else {
+		hud.frags = -1;
+		hud.caption = -1;
+		hud.color = -1;
+	}
+}
 
 /* ----------------------------------------------------------------- */
 /* -- Draw the status display */
 
 void DrawStatus(Bool first, Bool ForceDraw)
 {
+	static const unsigned char specials[] = {
+		MACHINE_GUNS, AIR_BRAKES, LUCKY_IRISH, TRIPLE_FIRE, LONG_RANGE
+	};
 	static int nextDraw;
-	static int lastDisplayed;
-	int		Score;
-	static int	lastScore, lastScores[MAX_PLAYERS];
-	static int	lastWave;
-	int		Lives;
-	static	int	lastLives;
-	static int	lastLife[MAX_PLAYERS];
-	int		Bonus;
-	static int	lastBonus;
-	int		Frags;
-	static int	lastFrags;
-	int		AutoFire;
-	static int	lastGun;
-	int		AirBrakes;
-	static int	lastBrakes;
-	int		ShieldLevel;
-	static int	lastShield;
-	int		MultFactor;
-	static int	lastMult;
-	int		LongFire;
-	static int	lastLong;
-	int		TripleFire;
-	static int	lastTriple;
-	int		LuckOfTheIrish;
-	static int	lastLuck;
-	static int	fragoff;
-	static int score_width, wave_width;
-	static int lives_width, bonus_width;
-	static int frags_width;
+	static int lastScores[MAX_PLAYERS];
+	static int lastLife[MAX_PLAYERS];
+	int Score;
 	int i;
-	char numbuf[128];
 
 	if (first) {
-		int x;
-
 		nextDraw = 1;
-		lastDisplayed = -1;
 		OBJ_LOOP(i, gNumPlayers)
 			lastScores[i] = -1;
-		lastScore = -1;
-		lastWave = -1;
-		lastShield = -1;
-		lastLives = -1;
-		lastBonus = -1;
-		lastFrags = -1;
-		lastGun = -1;
-		lastBrakes = -1;
-		lastMult = -1;
-		lastLuck = -1;
 		if (gWave == 1) {
 			OBJ_LOOP(i, gNumPlayers)
 				lastLife[i] = 0;
 		}
-		lastLong = -1;
-		lastTriple = -1;
-	
-		score_width = 0;
-		wave_width = 0;
-		lives_width = 0;
-		bonus_width = 0;
-		frags_width = 0;
-	
-/* -- Draw the status display */
 
-		screen->DrawLine(0, gStatusLine, SCREEN_WIDTH-1, 
-							gStatusLine, ourWhite);
-		x = 3;
-		i = DrawText(x, gStatusLine+11, "Score:", geneva, STYLE_BOLD,
-						30000>>8, 30000>>8, 0xFF);
-		x += (i+70);
-		i = DrawText(x, gStatusLine+11, "Shield:", geneva, STYLE_BOLD,
-						30000>>8, 30000>>8, 0xFF);
-		x += (i+70);
-		i = DrawText(x, gStatusLine+11, "Wave:", geneva, STYLE_BOLD,
-						30000>>8, 30000>>8, 0xFF);
-		x += (i+30);
-		i = DrawText(x, gStatusLine+11, "Lives:", geneva, STYLE_BOLD,
-						30000>>8, 30000>>8, 0xFF);
-		x += (i+30);
-		DrawText(x, gStatusLine+11, "Bonus:", geneva, STYLE_BOLD,
-						30000>>8, 30000>>8, 0xFF);
-		/* Heh, DOOM style frag count */
-		if ( gNumPlayers > 1 ) {
-			x = 530;
-			i = DrawText(x, gStatusLine+11, "Frags:", geneva,
-					STYLE_BOLD, 30000>>8, 30000>>8, 0xFF);
-			fragoff = x+i+4;
-		}
+		/* -- The screen was cleared, so everything is drawn again */
+		status->Reset();
 	}
 
 	if ( ForceDraw || (--nextDraw == 0) ) {
 		nextDraw = DISPLAY_DELAY+1;
-		/* -- Do incremental updates */
-	
-		if ( (gNumPlayers > 1) && (lastDisplayed != gDisplayed) ) {
-			char caption[BUFSIZ];
-
-			lastDisplayed = gDisplayed;
-			screen->FillRect(0, 0, SCREEN_WIDTH, 12, ourBlack);
-			SDL_snprintf(caption, sizeof(caption),
-				"You are player %d --- displaying player %d",
-						gOurPlayer+1, gDisplayed+1);
-			DrawText(SPRITES_WIDTH, 11, caption, geneva,
-					STYLE_BOLD, 30000>>8, 30000>>8, 0xFF);
-
-			/* Fill in the color by the frag count */
-			screen->FillRect(518, gStatusLine+4, 4, 8,
-							TheShip->Color());
-		}
 
-		ShieldLevel = TheShip->GetShieldLevel();
-		if (lastShield != ShieldLevel) {
-			int	fact;
-
-			lastShield = ShieldLevel;
-			screen->DrawRect(152, gStatusLine+4, SHIELD_WIDTH, 
-								8, ourWhite);
-			fact = ((SHIELD_WIDTH - 2) * ShieldLevel) / MAX_SHIELD;
-			screen->FillRect(152+1,gStatusLine+4+1, fact, 6,
-								ourGrey);
-			screen->FillRect(152+1+fact, gStatusLine+4+1,
-					SHIELD_WIDTH-2-fact, 6, ourBlack);
-		}
-		
-		MultFactor = TheShip->GetBonusMult();
-		if (lastMult != MultFactor) {
-			lastMult = MultFactor;
-		
-			switch (MultFactor) {
-				case 1:	screen->FillRect(424,
-						gStatusLine+4, 8, 8, ourBlack);
-					break;
-				case 2:	screen->QueueBlit(424, gStatusLine+4,
-							gMult2Icon, NOCLIP);
-					break;
-				case 3:	screen->QueueBlit(424, gStatusLine+4,
-							gMult3Icon, NOCLIP);
-					break;
-				case 4:	screen->QueueBlit(424, gStatusLine+4,
-							gMult4Icon, NOCLIP);
-					break;
-				case 5:	screen->QueueBlit(424, gStatusLine+4,
-							gMult5Icon, NOCLIP);
-					break;
-				default:  /* WHAT? */
-					break;
-			}
-		}
-	
-		/* -- Do incremental updates */
-	
-		AutoFire = TheShip->GetSpecial(MACHINE_GUNS);
-		if (lastGun != AutoFire) {
-			lastGun = AutoFire;
-
-			if ( AutoFire > 0 ) {
-				screen->QueueBlit(438, gStatusLine+4,
-						gAutoFireIcon, NOCLIP);
-			} else {
-				screen->FillRect(438, gStatusLine+4, 8, 8,
-								ourBlack);
-			}
-		}
-	
-		AirBrakes = TheShip->GetSpecial(AIR_BRAKES);
-		if (lastBrakes != AirBrakes) {
-			lastBrakes = AirBrakes;
-
-			if ( AirBrakes > 0 ) {
-				screen->QueueBlit(454, gStatusLine+4,
-						gAirBrakesIcon, NOCLIP);
-			} else {
-				screen->FillRect(454, gStatusLine+4, 8, 8,
-								ourBlack);
-			}
-		}
-	
-		LuckOfTheIrish = TheShip->GetSpecial(LUCKY_IRISH);
-		if (lastLuck != LuckOfTheIrish) {
-			lastLuck = LuckOfTheIrish;
-
-			if ( LuckOfTheIrish > 0 ) {
-				screen->QueueBlit(470, gStatusLine+4, 
-						gLuckOfTheIrishIcon, NOCLIP);
-			} else {
-				screen->FillRect(470, gStatusLine+4, 8, 8,
-								ourBlack);
-			}
-		}
-	
-		TripleFire = TheShip->GetSpecial(TRIPLE_FIRE);
-		if (lastTriple != TripleFire) {
-			lastTriple = TripleFire;
-
-			if ( TripleFire > 0 ) {
-				screen->QueueBlit(486, gStatusLine+4,
-						gTripleFireIcon, NOCLIP);
-			} else {
-				screen->FillRect(486, gStatusLine+4, 8, 8,
-								ourBlack);
-			}
-		}
-	
-		LongFire = TheShip->GetSpecial(LONG_RANGE);
-		if (lastLong != LongFire) {
-			lastLong = LongFire;
-
-			if ( LongFire > 0 ) {
-				screen->QueueBlit(502, gStatusLine+4,
-						gLongFireIcon, NOCLIP);
-			} else {
-				screen->FillRect(502, gStatusLine+4, 8, 8,
-								ourBlack);
-			}
-		}
-	
 		/* Check for everyone else's new lives */
 		OBJ_LOOP(i, gNumPlayers) {
 			Score = gPlayers[i]->GetScore();
 	
-			if ( (i == gDisplayed) && (Score != lastScore) ) {
-				/* -- Erase old and draw new score */
-				screen->FillRect(45, gStatusLine+1,
-					score_width, text_height, ourBlack);
-				SDL_snprintf(numbuf, sizeof(numbuf), "%d", Score);
-				score_width = DrawText(45, gStatusLine+11, 
-						numbuf, geneva, STYLE_BOLD,
-							0xFF, 0xFF, 0xFF);
-				lastScore = Score;
+			if ( i == gDisplayed ) {
+				status->Set(hud.score, Score);
 			}
 
 			if (lastScores[i] == Score)
@@ -376,51 +192,23 @@ void DrawStatus(Bool first, Bool ForceDraw)
 					sound->PlaySound(gNewLife, 5);
 			}
 		}
-	
-		if (lastWave != gWave) {
-			screen->FillRect(255, gStatusLine+1,
-					wave_width, text_height, ourBlack);
-			SDL_snprintf(numbuf, sizeof(numbuf), "%d", gWave);
-			wave_width = DrawText(255, gStatusLine+11, 
-					numbuf, geneva, STYLE_BOLD,
-							0xFF, 0xFF, 0xFF);
-			lastWave = gWave;
-		}
-	
-		Lives = TheShip->GetLives();
-		if (lastLives != Lives) {
-			screen->FillRect(319, gStatusLine+1,
-					lives_width, text_height, ourBlack);
-			SDL_snprintf(numbuf, sizeof(numbuf), "%-3.1d", Lives);
-			lives_width = DrawText(319, gStatusLine+11,
-					numbuf, geneva, STYLE_BOLD,
-							0xFF, 0xFF, 0xFF);
-			lastLives = Lives;
-		}
-	
-		Bonus = TheShip->GetBonus();
-		if (lastBonus != Bonus) {
-			screen->FillRect(384, gStatusLine+1,
-					bonus_width, text_height, ourBlack);
-			SDL_snprintf(numbuf, sizeof(numbuf), "%-7.1d", Bonus);
-			bonus_width = DrawText(384, gStatusLine+11,
-					numbuf, geneva, STYLE_BOLD,
-							0xFF, 0xFF, 0xFF);
-			lastBonus = Bonus;
-		}
 
+		/* -- Only the values that changed are drawn */
+		status->Set(hud.caption, gDisplayed+1);
+		status->Set(hud.color, TheShip->Color());
+		status->Set(hud.shield, TheShip->GetShieldLevel());
+		status->Set(hud.mult, TheShip->GetBonusMult());
+		for ( i=0; i<(int)SDL_arraysize(specials); ++i ) {
+			status->Set(hud.specials[i],
+				(TheShip->GetSpecial(specials[i]) > 0));
+		}
+		status->Set(hud.wave, gWave);
+		status->Set(hud.lives, TheShip->GetLives());
+		status->Set(hud.bonus, TheShip->GetBonus());
 		if ( gNumPlayers > 1 ) {
-			Frags = TheShip->GetFrags();
-			if (lastFrags != Frags) {
-				screen->FillRect(fragoff, gStatusLine+1,
-					frags_width, text_height, ourBlack);
-				SDL_snprintf(numbuf, sizeof(numbuf), "%-3.1d", Frags);
-				frags_width = DrawText(fragoff, gStatusLine+11,
-						numbuf, geneva, STYLE_BOLD,
-							0xFF, 0xFF, 0xFF);
-				lastFrags = Frags;
-			}
+			status->Set(hud.frags, TheShip->GetFrags());
 		}
+		status->Draw();
 	}
 }	/* -- DrawStatus */
 
@@ -454,6 +242,7 @@ void NewGame(void)
 	ourGrey = screen->MapRGB(30000>>8, 30000>>8, 0xFF);
 	ourWhite = screen->MapRGB(0xFF, 0xFF, 0xFF);
 	ourBlack = screen->MapRGB(0x00, 0x00, 0x00);
+	NewStatus();
 
 	/* Fade into game mode */
 	screen->Fade();
@@ -479,6 +268,8 @@ void NewGame(void)
 
 	DoGameOver();
 	screen->ShowCursor();
+	delete status;
+	status = NULL;
 	delete geneva;
 }	/* -- NewGame */
 
@@ -495,10 +286,9 @@ static void DoHouseKeeping(void)
 		return;
 	}
 
-#ifdef MOVIE_SUPPORT
-	if ( gMovie )
-		win->ScreenDump("MovieFrame", &gMovieRect);
-#endif
+	/* What we draw here is presented along with the next frame */
+	screen->BeginFrame();
+
 	/* -- Maybe throw a multiplier up on the screen */
 	if (gMultiplierShown && (--gMultiplierShown == 0) )
 		MakeMultiplier();
@@ -541,8 +331,11 @@ static void DoHouseKeeping(void)
 	if (gNumRocks == 0) {
 		if ( gWhenDone == 0 )
 			gWhenDone = DEAD_DELAY;
-		else if ( --gWhenDone == 0 )
+		else if ( --gWhenDone == 0 ) {
+			/* The wave display is presented as it's drawn */
+			screen->EndFrame();
 			NextWave();
+		}
 	}
 	
 	/* -- Housekeping */
@@ -670,7 +463,9 @@ static void NextWave(void)
 	}
 	screen->Update(1);
 	screen->FocusFG();
-	screen->Fade();
+
+	/* The wave fades in while it starts playing */
+	screen->StartFade();
 }	/* -- NextWave */
 
 /* ----------------------------------------------------------------- */
@@ -929,7 +724,7 @@ static void DoBonus(void)
 		}
 
 		if (OurShip->GetBonusMult() != 1) {
-			SDL_Surface *sprite;
+			AtlasFrame *sprite;
 
 			SDL_snprintf(numbuf, sizeof(numbuf), "%-5.1d", OurShip->GetBonus());
 			DrawText(x, 200, numbuf, geneva, STYLE_BOLD,
@@ -938,7 +733,7 @@ static void DoBonus(void)
 			OurShip->MultBonus();
 			Delay(SOUND_DELAY);
 			sound->PlaySound(gMultiplier, 5);
-			sprite = gMult[OurShip->GetBonusMult()-2]->sprite[0];
+			sprite = &gMult[OurShip->GetBonusMult()-2]->sprite[0];
 			screen->QueueBlit(xs+34, 180, sprite);
 			screen->Update();
 			Delay(60);
@@ -0,0 +1,73 @@
+
+#ifndef _hitgrid_h
+#define _hitgrid_h
+
+/* A uniform grid of screen cells, for the broad phase of hit detection:
+
+   The areas a ship can hit things with, its body and its shots, are
+   marked in the cells they touch.  An object whose hit rectangle touches
+   no marked cell can't overlap any of them, so calling its HitBy() with
+   that ship would do nothing, and can be skipped.  The grid wraps around
+   at its edges, so areas hanging off the playground are marked on the
+   other side, which only ever adds cells.  Clear() starts a new marking
+   generation instead of wiping the cells.
+*/
+
+#define HITGRID_SHIFT	5		/* 32 pixel cells, the sprite size */
+#define HITGRID_COLS	32		/* Powers of two, covering the screen */
+#define HITGRID_ROWS	16
+
+class HitGrid {
+
+public:
+	HitGrid() {
+		memset(cells, 0, sizeof(cells));
+		generation = 1;
+	}
+
+	/* Forget all the marked areas */
+	void Clear(void) {
+		if ( ++generation == 0 ) {
+			memset(cells, 0, sizeof(cells));
+			generation = 1;
+		}
+	}
+
+	/* Mark the cells touched by an area, in screen coordinates */
+	void Add(const Rect *area) {
+		int row, col;
+
+		for ( row=(area->top>>HITGRID_SHIFT);
+				row<=(area->bottom>>HITGRID_SHIFT); ++row ) {
+			for ( col=(area->left>>HITGRID_SHIFT);
+				col<=(area->right>>HITGRID_SHIFT); ++col ) {
+				Cell(row, col) = generation;
+			}
+		}
+	}
+
+	/* Return whether an area touches any marked cell */
+	int Touches(const Rect *area) {
+		int row, col;
+
+		for ( row=(area->top>>HITGRID_SHIFT);
+				row<=(area->bottom>>HITGRID_SHIFT); ++row ) {
+			for ( col=(area->left>>HITGRID_SHIFT);
+				col<=(area->right>>HITGRID_SHIFT); ++col ) {
+				if ( Cell(row, col) == generation )
+					return(1);
+			}
+		}
+		return(0);
+	}
+
+private:
+	Uint32 cells[HITGRID_ROWS][HITGRID_COLS];
+	Uint32 generation;
+
+	Uint32 &Cell(int row, int col) {
+		return(cells[row&(HITGRID_ROWS-1)][col&(HITGRID_COLS-1)]);
+	}
+};
+
+#endif /* _hitgrid_h */
@@ -0,0 +1,239 @@
+
+#include "Maelstrom_Globals.h"
+#include "motion.h"
+
+
+MotionStore:: MotionStore()
+{
+	blocks = NULL;
+	numblocks = 0;
+	numreaching = 0;
+}
+
+MotionStore:: ~MotionStore()
+{
+	int i;
+
+	for ( i=0; i<numblocks; ++i ) {
+		delete blocks[i];
+	}
+	delete[] blocks;
+}
+
+MotionBlock *
+MotionStore:: Alloc(int *slot)
+{
+	MotionBlock *block, **newblocks;
+	int i;
+
+	for ( i=0; i<numblocks; ++i ) {
+		if ( blocks[i]->numused < MOTION_BLOCK ) {
+			break;
+		}
+	}
+	if ( i == numblocks ) {
+		/* All full, add a block, keeping the old ones where they are */
+		newblocks = new MotionBlock *[numblocks+1];
+		for ( i=0; i<numblocks; ++i ) {
+			newblocks[i] = blocks[i];
+		}
+		delete[] blocks;
+		blocks = newblocks;
+		blocks[numblocks] = new MotionBlock;
+		memset(blocks[numblocks], 0, sizeof(MotionBlock));
+		i = numblocks++;
+	}
+	block = blocks[i];
+
+	for ( i=0; block->flags[i]; ++i ) {
+		/* Find the free slot */;
+	}
+	block->flags[i] = (MOTION_USED|MOTION_COASTS);
+	++block->numused;
+	*slot = i;
+	return(block);
+}
+
+void
+MotionStore:: Free(MotionBlock *block, int slot)
+{
+	if ( block->flags[slot] & MOTION_REACHES ) {
+		--numreaching;
+	}
+
+	/* Clear it, so Coast() can work out free slots along harmlessly */
+	block->x[slot] = block->y[slot] = 0;
+	block->lastx[slot] = block->lasty[slot] = 0;
+	block->xvec[slot] = block->yvec[slot] = 0;
+	block->phase[slot] = block->phasetime[slot] = 0;
+	block->nextphase[slot] = 0;
+	block->TTL[slot] = 0;
+	block->flags[slot] = 0;
+	--block->numused;
+}
+
+void
+MotionStore:: Reaches(MotionBlock *block, int slot)
+{
+	if ( ! (block->flags[slot] & MOTION_REACHES) ) {
+		block->flags[slot] |= MOTION_REACHES;
+		++numreaching;
+	}
+}
+
+/* The positions, with no branches for the compiler to vectorize */
+static inline int Wrap(int pos, int low, int high)
+{
+	pos = ((pos > high) ? (low + (pos - high)) : pos);
+	pos = ((pos < low) ? (high - (low - pos)) : pos);
+	return(pos);
+}
+
+/* One coordinate of every slot is worked out, and the coasting ones kept */
+static void CoastAxis(int *pos, int *last, const int *vec, const Uint8 *flags,
+							int low, int high)
+{
+	int i, coasts, now, was, next;
+
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		coasts = (flags[i] & MOTION_COASTS);
+		now = pos[i];
+		was = last[i];
+		next = Wrap(now + vec[i], low, high);
+		last[i] = (coasts ? now : was);
+		pos[i] = (coasts ? next : now);
+	}
+}
+
+/* Each slot's values are all loaded, for the compiler to vectorize */
+static void CoastFrozen(MotionBlock *block)
+{
+	int i, coasts, now, was;
+
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		coasts = (block->flags[i] & MOTION_COASTS);
+		now = block->x[i];
+		was = block->lastx[i];
+		block->lastx[i] = (coasts ? now : was);
+	}
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		coasts = (block->flags[i] & MOTION_COASTS);
+		now = block->y[i];
+		was = block->lasty[i];
+		block->lasty[i] = (coasts ? now : was);
+	}
+}
+
+/* Everything else Object::SetPos() does */
+static void CoastHits(MotionBlock *block)
+{
+	int i, coasts, X, Y;
+	Rect R, hit;
+
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		coasts = (block->flags[i] & MOTION_COASTS);
+		X = (block->x[i]>>SPRITE_PRECISION);
+		Y = (block->y[i]>>SPRITE_PRECISION);
+		R = block->HitRect[i];
+		hit = block->blitRect[i];
+		R.left = (coasts ? (hit.left + X) : R.left);
+		R.right = (coasts ? (hit.right + X) : R.right);
+		R.top = (coasts ? (hit.top + Y) : R.top);
+		R.bottom = (coasts ? (hit.bottom + Y) : R.bottom);
+		block->HitRect[i] = R;
+	}
+}
+
+/* What Object::Phase() does */
+static void CoastPhases(MotionBlock *block)
+{
+	int i, phases, next, turn, was, phase;
+
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		phases = ((block->flags[i] & MOTION_COASTS) != 0) &
+			 (block->phasetime[i] != NO_PHASE_CHANGE);
+		next = block->nextphase[i];
+		turn = (next >= block->phasetime[i]);
+		was = block->phase[i];
+		phase = ((was+1 >= block->numFrames[i]) ? 0 : was+1);
+		phase = (turn ? phase : was);
+		next = (turn ? 0 : next+1);
+		block->nextphase[i] = (phases ? next : block->nextphase[i]);
+		block->phase[i] = (phases ? phase : was);
+	}
+}
+
+/* The rest of Object::Move(), leaving the timeouts to Object::Step() */
+static void CoastTimes(MotionBlock *block)
+{
+	int i, coasts, ttl;
+	Uint8 flags;
+
+	for ( i=0; i<MOTION_BLOCK; ++i ) {
+		flags = block->flags[i];
+		coasts = ((flags & MOTION_COASTS) != 0);
+		ttl = block->TTL[i];
+		block->TTL[i] = ttl - (coasts & (ttl != 0));
+		flags &= ~(MOTION_MOVED|MOTION_EXPIRED);
+		flags |= (coasts ? MOTION_MOVED : 0);
+		flags |= ((coasts & (ttl == 1)) ? MOTION_EXPIRED : 0);
+		block->flags[i] = flags;
+	}
+}
+
+int
+MotionStore:: Coast(int Frozen)
+{
+	MotionBlock *block;
+	Rect playground;
+	int b, i, wait;
+
+	/* See if a timeout has to wait for its turn in gSprites[] */
+	wait = 0;
+	for ( b=0; numreaching && b<numblocks; ++b ) {
+		block = blocks[b];
+		for ( i=0; i<MOTION_BLOCK; ++i ) {
+			if ( (block->flags[i] & MOTION_REACHES) &&
+			     (block->flags[i] & MOTION_COASTS) &&
+			     (block->TTL[i] == 1) ) {
+				wait = 1;
+			}
+		}
+	}
+	if ( wait ) {
+		for ( b=0; b<numblocks; ++b ) {
+			block = blocks[b];
+			for ( i=0; i<MOTION_BLOCK; ++i ) {
+				block->flags[i] &= ~(MOTION_MOVED|MOTION_EXPIRED);
+			}
+		}
+		return(0);
+	}
+
+	playground.left = (gScrnRect.left<<SPRITE_PRECISION);
+	playground.right = (gScrnRect.right<<SPRITE_PRECISION);
+	playground.top = (gScrnRect.top<<SPRITE_PRECISION);
+	playground.bottom = (gScrnRect.bottom<<SPRITE_PRECISION);
+
+	for ( b=0; b<numblocks; ++b ) {
+		block = blocks[b];
+		if ( ! block->numused ) {
+			continue;
+		}
+		if ( Frozen ) {
+			CoastFrozen(block);
+		} else {
+			CoastAxis(block->x, block->lastx, block->xvec,
+				block->flags, playground.left, playground.right);
+			CoastAxis(block->y, block->lasty, block->yvec,
+				block->flags, playground.top, playground.bottom);
+			CoastHits(block);
+		}
+		CoastPhases(block);
+		CoastTimes(block);
+	}
+	return(1);
+}
+
+/* The motion of all the objects */
+MotionStore gMotion;
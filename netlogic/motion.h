@@ -0,0 +1,72 @@
+
+#ifndef _motion_h
+#define _motion_h
+
+/* The motion of the objects, stored a field at a time across all of them:
+
+   Every object has a slot here, and its position, velocity, phase,
+   lifetime and hit rectangle are that slot's entries in arrays of each,
+   which the object refers to, next to a copy of its sprite's frame count
+   and hit rectangle.  The objects that just coast, moving in a straight
+   line and wrapping around at the edges with Object::Move(), are moved
+   all at once by Coast(), a pass at a time over the arrays, instead of
+   with a virtual Move() each.  Objects with a Move() of their own are
+   left out.  The slots come in blocks that never move, so objects can
+   keep referring to them as more are added.
+*/
+
+#define MOTION_BLOCK	128		/* Slots in each block */
+
+/* The flags of a slot */
+#define MOTION_USED	0x01		/* It belongs to an object */
+#define MOTION_COASTS	0x02		/* Its object moves with Object::Move() */
+#define MOTION_REACHES	0x04		/* Its timeout does things to others */
+#define MOTION_MOVED	0x08		/* Coast() has moved it this time step */
+#define MOTION_EXPIRED	0x10		/* ... and it ran out of time */
+
+typedef struct {
+	int x[MOTION_BLOCK], y[MOTION_BLOCK];
+	int lastx[MOTION_BLOCK], lasty[MOTION_BLOCK];
+	int xvec[MOTION_BLOCK], yvec[MOTION_BLOCK];
+	int phase[MOTION_BLOCK];
+	int phasetime[MOTION_BLOCK];
+	int nextphase[MOTION_BLOCK];
+	int TTL[MOTION_BLOCK];
+	int numFrames[MOTION_BLOCK];	/* Of the sprite */
+	Rect blitRect[MOTION_BLOCK];	/* The sprite's hit rectangle */
+	Rect HitRect[MOTION_BLOCK];	/* ... where the object is */
+	Uint8 flags[MOTION_BLOCK];
+	int numused;
+} MotionBlock;
+
+class MotionStore {
+
+public:
+	MotionStore();
+	~MotionStore();
+
+	/* Give out a slot that coasts, returning its block */
+	MotionBlock *Alloc(int *slot);
+	void Free(MotionBlock *block, int slot);
+
+	/* Mark a slot whose object's timeout does things to other objects */
+	void Reaches(MotionBlock *block, int slot);
+
+	/* Move all of the objects that coast, the way Object::Move() would,
+	   marking the ones that ran out of time.  Their timeouts are left to
+	   Object::Step(), in the order of gSprites[].  If one of those would
+	   do things to other objects, which would then have been moved before
+	   or after it depending on that order, nothing is moved here and this
+	   returns 0, so they all Move() themselves this time step.
+	 */
+	int Coast(int Frozen);
+
+private:
+	MotionBlock **blocks;
+	int numblocks;
+	int numreaching;	/* Slots marked by Reaches() */
+};
+
+extern MotionStore gMotion;
+
+#endif /* _motion_h */
@@ -5,7 +5,16 @@
 
 /* The screen object class */
 
-Object::Object(int X, int Y, int Xvec, int Yvec, Blit *blit, int PhaseTime)
+Object::Object(int X, int Y, int Xvec, int Yvec, Blit *blit, int PhaseTime) :
+	motion(gMotion.Alloc(&slot)),
+	x(motion->x[slot]), y(motion->y[slot]),
+	lastx(motion->lastx[slot]), lasty(motion->lasty[slot]),
+	xvec(motion->xvec[slot]), yvec(motion->yvec[slot]),
+	TTL(motion->TTL[slot]),
+	phase(motion->phase[slot]),
+	phasetime(motion->phasetime[slot]),
+	nextphase(motion->nextphase[slot]),
+	HitRect(motion->HitRect[slot])
 {
 	Points = DEFAULT_POINTS;
 
@@ -21,7 +30,7 @@ Object::Object(int X, int Y, int Xvec, int Yvec, Blit *blit, int PhaseTime)
 	playground.top = (gScrnRect.top<<SPRITE_PRECISION);
 	playground.bottom = (gScrnRect.bottom<<SPRITE_PRECISION);
 
-	SetPos(X, Y);
+	Place(X, Y);
 	xvec = Xvec;
 	yvec = Yvec;
 
@@ -30,13 +39,13 @@ Object::Object(int X, int Y, int Xvec, int Yvec, Blit *blit, int PhaseTime)
 	HitPoints = DEFAULT_HITS;
 	Exploding = 0;
 	Set_TTL(-1);
-	onscreen = 0;
 	++gNumSprites;
 }
 
 Object::~Object()
 {
 //error("Object destructor called!\n");
+	gMotion.Free(motion, slot);
 	--gNumSprites;
 }
 
@@ -65,6 +74,8 @@ Object::Explode(void)
 int 
 Object::Move(int Frozen)		// This is called every timestep.
 {
+	lastx = x;
+	lasty = y;
 	if ( ! Frozen )
 		SetPos(x+xvec, y+yvec);
 
@@ -78,27 +89,10 @@ Object::Move(int Frozen)		// This is called every timestep.
 	return(0);
 }
 void
-Object::BlitSprite(void)
+Object::BlitSprite(int frac)
 {
-	screen->QueueBlit(x>>SPRITE_PRECISION, y>>SPRITE_PRECISION,
-							myblit->sprite[phase]);
-	onscreen = 1;
-}
-void
-Object::UnBlitSprite(void)
-{
-	/* Only unblit if we were onscreen */
-	if ( ! onscreen )
-		return;
-
-	if ( myblit->isSmall ) {
-		screen->Clear(x>>SPRITE_PRECISION, y>>SPRITE_PRECISION, 16, 16,
-									DOCLIP);
-	} else {
-		screen->Clear(x>>SPRITE_PRECISION, y>>SPRITE_PRECISION, 32, 32,
-									DOCLIP);
-	}
-	onscreen = 0;
+	screen->QueueSprite(BlendX(frac)>>SPRITE_PRECISION,
+			BlendY(frac)>>SPRITE_PRECISION, &myblit->sprite[phase]);
 }
 
 /* Sound functions */
@@ -115,3 +109,8 @@ Object::ExplodeSound(void)
 
 /* The objects!! */
 Object *gSprites[MAX_SPRITES];
+
+#ifdef COLLIDE_STATS
+/* How much work the pixel tests did */
+CollideStats gCollideStats;
+#endif
@@ -2,6 +2,104 @@
 #ifndef _object_h
 #define _object_h
 
+#include "hitgrid.h"
+#include "motion.h"
+#include "objpool.h"
+
+/* Sprites can be drawn between two time steps, 'frac' of the way from
+   where they were before the last Move() to where they are now, out of
+   BLEND_ONE.  A step longer than BLEND_JUMP is a wrap around the edge of
+   the playground, and the sprite is drawn where it is now.
+*/
+#define BLEND_BITS	8
+#define BLEND_ONE	(1<<BLEND_BITS)
+#define BLEND_JUMP	(64<<SPRITE_PRECISION)
+
+static inline int Blend(int last, int now, int frac)
+{
+	int step = (now - last);
+
+	if ( (step > BLEND_JUMP) || (step < -BLEND_JUMP) )
+		return(now);
+	return(last + ((step * frac) >> BLEND_BITS));
+}
+
+/* Shots keep no last position, they moved 'vel' from it, wrapping around
+   the edges of the playground between 'low' and 'high'.  If that put them
+   outside of it, they wrapped, and they're drawn where they are now.
+*/
+static inline int BlendShot(int now, int vel, int low, int high, int frac)
+{
+	int last = (now - vel);
+
+	if ( (last < low) || (last > high) )
+		return(now);
+	return(Blend(last, now, frac));
+}
+
+/* The bits of a collision mask from a column of a row on, in the top bits.
+   The masks are read the way the byte masks they replaced were: past the
+   end of a row the bits go on into the next row, and past the last row
+   the mask is empty.
+ */
+static inline Uint32 MaskBits(const Uint32 *mask, int row, int col)
+{
+	Uint32 bits = 0;
+
+	if ( row < 32 ) {
+		bits = (mask[row] << col);
+		if ( col && (row+1 < 32) )
+			bits |= (mask[row+1] >> (32-col));
+	}
+	return(bits);
+}
+static inline Uint32 MaskBits(const Uint16 *mask, int row, int col)
+{
+	Uint64 bits = 0;
+	int i;
+
+	for ( i=0; i<3; ++i ) {
+		bits <<= 16;
+		if ( row+i < 16 )
+			bits |= mask[row+i];
+	}
+	return((Uint32)((bits << col) >> 16));
+}
+
+/* See if 'width' pixels of two masks overlap on any of 'height' rows */
+template <class Row1, class Row2>
+static inline int CollideMasks(const Row1 *mask1, int row1, int col1,
+			const Row2 *mask2, int row2, int col2,
+						int width, int height)
+{
+	Uint32 span;
+
+	if ( width <= 0 )
+		return(0);
+	span = ((width < 32) ? ~(0xFFFFFFFF >> width) : 0xFFFFFFFF);
+	while ( height-- > 0 ) {
+		if ( MaskBits(mask1, row1++, col1) &
+		     MaskBits(mask2, row2++, col2) & span )
+			return(1);
+	}
+	return(0);
+}
+
+/* Counts of the pixel tests done by Object::Collide(), which are only
+   kept when built with COLLIDE_STATS defined, for -speedtest bounds.
+*/
+#ifdef COLLIDE_STATS
+typedef struct {
+	Uint32 masks;		/* Pairs with overlapping hit rectangles */
+	Uint32 rejects;		/* Pairs whose set pixels' boxes don't meet */
+	Uint32 rows;		/* Mask rows tested */
+	Uint32 full_rows;	/* Mask rows in the hit rectangles' overlap */
+} CollideStats;
+extern CollideStats gCollideStats;
+#define COLLIDE_COUNT(stat, n)	(gCollideStats.stat += (n))
+#else
+#define COLLIDE_COUNT(stat, n)
+#endif
 
 /* The screen object class */
 class Object {
@@ -21,6 +119,8 @@ public:
 	/* Settings */
 	void Set_Blit(Blit *blit) {
 		myblit = blit;
+		motion->numFrames[slot] = blit->numFrames;
+		motion->blitRect[slot] = blit->hitRect;
 		if ( myblit->isSmall )
 			xsize = ysize = 16;
 		else
@@ -58,9 +158,9 @@ public:
 
 		/* Check the bitmasks to see if the sprites really intersect */
 		int  xoff1, xoff2;
-		int  roff;
-		unsigned char *mask1, *mask2;
-		int checkwidth, checkheight, w;
+		int  yoff1, yoff2;
+		int checkwidth, checkheight;
+		SpriteMask mask1, mask2;
 
 		/* -- Load the ptrs to the sprite masks */
 		mask1 = myblit->mask[phase];
@@ -83,24 +183,90 @@ public:
 		if ( R2->top < R1->top ) {
 			/* The second sprite is above of the first one */
 			checkheight = (R2->bottom-R1->top);
-			mask2 += (R1->top-R2->top)*object->xsize;
+			yoff2 = R1->top-R2->top;
+			yoff1 = 0;
 		} else {
 			/* The first sprite is on top of the second one */
 			checkheight = (R1->bottom-R2->top);
-			mask1 += (R2->top-R1->top)*xsize;
+			yoff1 = R2->top-R1->top;
+			yoff2 = 0;
 		}
 
-		/* Do the actual mask hit detection */
-		while ( checkheight-- ) {
-			for ( roff=0, w=checkwidth; w; --w, ++roff ) {
-				if ( mask1[xoff1+roff] && mask2[xoff2+roff] )
-					return(1);
+		/* Trim the test to the boxes around the pixels set in each
+		   frame, unless a row runs on into the next one.
+		 */
+		COLLIDE_COUNT(masks, 1);
+		COLLIDE_COUNT(full_rows, checkheight);
+		if ( ((xoff1+checkwidth) <= xsize) &&
+		     ((xoff2+checkwidth) <= object->xsize) ) {
+			Rect *B1 = &myblit->bounds[phase];
+			Rect *B2 = &(object->myblit)->bounds[object->phase];
+			int first, last;
+
+			first = 0;
+			if ( first < (B1->left-xoff1) )
+				first = (B1->left-xoff1);
+			if ( first < (B2->left-xoff2) )
+				first = (B2->left-xoff2);
+			last = checkwidth-1;
+			if ( last > (B1->right-xoff1) )
+				last = (B1->right-xoff1);
+			if ( last > (B2->right-xoff2) )
+				last = (B2->right-xoff2);
+			xoff1 += first;
+			xoff2 += first;
+			checkwidth = (last-first+1);
+
+			first = 0;
+			if ( first < (B1->top-yoff1) )
+				first = (B1->top-yoff1);
+			if ( first < (B2->top-yoff2) )
+				first = (B2->top-yoff2);
+			last = checkheight-1;
+			if ( last > (B1->bottom-yoff1) )
+				last = (B1->bottom-yoff1);
+			if ( last > (B2->bottom-yoff2) )
+				last = (B2->bottom-yoff2);
+			yoff1 += first;
+			yoff2 += first;
+			checkheight = (last-first+1);
+
+			if ( (checkwidth <= 0) || (checkheight <= 0) ) {
+				COLLIDE_COUNT(rejects, 1);
+				return(0);
 			}
-			mask1 += xsize;
-			mask2 += object->xsize;
 		}
-		return(0);
+		COLLIDE_COUNT(rows, checkheight);
+
+		/* Do the actual mask hit detection, a row at a time */
+		if ( myblit->isSmall ) {
+			if ( object->myblit->isSmall )
+				return(CollideMasks(mask1.small, yoff1, xoff1,
+						mask2.small, yoff2, xoff2,
+						checkwidth, checkheight));
+			return(CollideMasks(mask1.small, yoff1, xoff1,
+						mask2.large, yoff2, xoff2,
+						checkwidth, checkheight));
+		}
+		if ( object->myblit->isSmall )
+			return(CollideMasks(mask1.large, yoff1, xoff1,
+						mask2.small, yoff2, xoff2,
+						checkwidth, checkheight));
+		return(CollideMasks(mask1.large, yoff1, xoff1,
+						mask2.large, yoff2, xoff2,
+						checkwidth, checkheight));
 	}
+	/* Mark the areas we can hit things with in the grid */
+	virtual void MarkHits(HitGrid *grid) {
+		grid->Add(&HitRect);
+	}
+	/* See if HitBy() could do anything, with the areas of a ship that
+	   are marked in the grid.  Nothing we do in HitBy() moves them.
+	 */
+	int InReach(HitGrid *grid) {
+		return(grid->Touches(&HitRect));
+	}
+
 	/* Should be called in main loop -- return (-1) if dead */
 	virtual int HitBy(Object *ship) {
 		Shot *shot;
@@ -186,6 +352,12 @@ public:
 		HitRect.top = myblit->hitRect.top+(y>>SPRITE_PRECISION);
 		HitRect.bottom = myblit->hitRect.bottom+(y>>SPRITE_PRECISION);
 	}
+	/* Put it somewhere, without drawing it on the way there */
+	void Place(int X, int Y) {
+		SetPos(X, Y);
+		lastx = x;
+		lasty = y;
+	}
 	virtual void Shake(int shakiness) {
 		int Xvec = ((xvec < 0) ? shakiness : -shakiness);
 		int Yvec = ((yvec < 0) ? shakiness : -shakiness);
@@ -212,9 +384,21 @@ public:
 	}
 	/* This function returns 0, or -1 if the sprite died */
 	virtual int Move(int Frozen);
+	/* This is called instead every timestep, after gMotion.Coast() */
+	int Step(int Frozen) {
+		Uint8 flags = motion->flags[slot];
+
+		if ( ! (flags & MOTION_MOVED) )
+			return(Move(Frozen));
+
+		/* gMotion.Coast() did the rest of Move() already */
+		if ( flags & MOTION_EXPIRED )	// This sprite died...
+			return(BeenTimedOut());
+		return(0);
+	}
 
-	virtual void BlitSprite(void);
-	virtual void UnBlitSprite(void);
+	/* Queue the sprite, 'frac' of the way through the last time step */
+	virtual void BlitSprite(int frac);
 
 	/* Sound functions */
 	virtual void HitSound(void);
@@ -233,24 +417,47 @@ public:
 	}
 
 protected:
+	/* Our slot in gMotion, where the fields that are references live */
+	int slot;
+	MotionBlock *motion;
+
 	int Points;
-	int x, y;
-	int xvec, yvec;
+	int &x, &y;
+	int &lastx, &lasty;	/* Where we were before the last Move() */
+	int &xvec, &yvec;
 	int xsize, ysize;
 	int solid;
 	int shootable;
 	int HitPoints;
-	int TTL;
+	int &TTL;
 
-	int onscreen;
-	int phase;
-	int phasetime;
-	int nextphase;
+	int &phase;
+	int &phasetime;
+	int &nextphase;
 	Blit *myblit;
-	Rect HitRect;
+	Rect &HitRect;
 	Rect playground;
 	int Exploding;
 
+	/* Objects with a Move() of their own call this when they are made,
+	   so that gMotion.Coast() leaves them to it.
+	 */
+	void MovesItself(void) {
+		motion->flags[slot] &= ~MOTION_COASTS;
+	}
+	/* Objects whose timeout does things to other objects call this */
+	void TimeoutReaches(void) {
+		gMotion.Reaches(motion, slot);
+	}
+
+	/* Where we are drawn, 'frac' of the way through the last time step */
+	int BlendX(int frac) {
+		return(Blend(lastx, x, frac));
+	}
+	int BlendY(int frac) {
+		return(Blend(lasty, y, frac));
+	}
+
 	/* See if two rectangles overlap */
 	int Overlap(Rect *R1, Rect *R2) {
 	/* If the top of R1 is below the bottom of R2, they can't overlap */
@@ -7,6 +7,22 @@
 #include "player.h"
 #include "globals.h"
 #include "objects.h"
+#include "shinobi.h"
+
+/* The pools the objects come from, with room for a screen full of rocks */
+ObjectPool Prize::pool("Prize", sizeof(Prize), MAX_SPRITES/4);
+ObjectPool Multiplier::pool("Multiplier", sizeof(Multiplier), MAX_SPRITES/4);
+ObjectPool Nova::pool("Nova", sizeof(Nova), MAX_SPRITES/4);
+ObjectPool Bonus::pool("Bonus", sizeof(Bonus), MAX_SPRITES/4);
+ObjectPool Shrapnel::pool("Shrapnel", sizeof(Shrapnel), MAX_SPRITES);
+ObjectPool DamagedShip::pool("DamagedShip", sizeof(DamagedShip), MAX_SPRITES/4);
+ObjectPool Gravity::pool("Gravity", sizeof(Gravity), MAX_SPRITES/4);
+ObjectPool Homing::pool("Homing", sizeof(Homing), MAX_SPRITES/4);
+ObjectPool SmallRock::pool("SmallRock", sizeof(SmallRock), MAX_SPRITES);
+ObjectPool MediumRock::pool("MediumRock", sizeof(MediumRock), MAX_SPRITES);
+ObjectPool LargeRock::pool("LargeRock", sizeof(LargeRock), MAX_SPRITES);
+ObjectPool SteelRoid::pool("SteelRoid", sizeof(SteelRoid), MAX_SPRITES/4);
+ObjectPool Shinobi::pool("Shinobi", sizeof(Shinobi), MAX_SPRITES/4);
 
 
 Prize::Prize(int X, int Y, int xVel, int yVel) :
@@ -33,6 +49,7 @@ error("Created a multiplier!\n");
 
 Nova::Nova(int X, int Y) : Object(X, Y, 0, 0, gNova, 4)
 {
+	TimeoutReaches();
 	Set_TTL(gNova->numFrames*phasetime);
 	Set_Points(NOVA_PTS);
 	phase = 0;
@@ -78,6 +95,7 @@ error("Created a damaged ship!\n");
 
 Gravity::Gravity(int X, int Y) : Object(X, Y, 0, 0, gVortexBlit, 2)
 {
+	MovesItself();
 	Set_Points(GRAVITY_PTS);
 	sound->PlaySound(gGravAppears, 4);
 #ifdef SERIOUS_DEBUG
@@ -89,6 +107,7 @@ Homing::Homing(int X, int Y, int xVel, int yVel) :
 	Object(X, Y, xVel, yVel, 
 		((xVel > 0) ? gMineBlitR : gMineBlitL), 2)
 {
+	MovesItself();
 	Set_HitPoints(HOMING_HITS);
 	Set_Points(HOMING_PTS);
 	target=AcquireTarget();
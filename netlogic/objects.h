@@ -5,6 +5,8 @@
 class Prize : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Prize(int X, int Y, int xVel, int yVel);
 	~Prize() { }
 
@@ -83,6 +85,8 @@ public:
 class Multiplier : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Multiplier(int X, int Y, int Mult);
 	~Multiplier() { }
 
@@ -108,6 +112,8 @@ protected:
 class Nova : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Nova(int X, int Y);
 	~Nova() { }
 
@@ -135,6 +141,8 @@ public:
 class Bonus : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Bonus(int X, int Y, int xVel, int yVel, int Bonus);
 	~Bonus() { }
 
@@ -173,6 +181,8 @@ protected:
 class Shrapnel : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Shrapnel(int X, int Y, int xVel, int yVel, Blit *blit);
 	~Shrapnel() { }
 
@@ -185,6 +195,8 @@ public:
 class DamagedShip : public Object {
 
 public:
+	POOLED_OBJECT
+
 	DamagedShip(int X, int Y, int xVel, int yVel);
 	~DamagedShip() { }
 
@@ -251,7 +263,7 @@ public:
 		nextphase = 0;
 		phasetime = 2;
 		xvec = yvec = 0;
-		myblit = gShipExplosion;
+		Set_Blit(gShipExplosion);
 		TTL = (myblit->numFrames*phasetime);
 		ExplodeSound();
 		return(0);
@@ -266,6 +278,8 @@ public:
 class Gravity : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Gravity(int X, int Y);
 	~Gravity() { }
 
@@ -311,6 +325,8 @@ public:
 class Homing : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Homing(int X, int Y, int xVel, int yVel);
 	~Homing() { }
 
@@ -359,6 +375,8 @@ protected:
 class SmallRock : public Object {
 
 public:
+	POOLED_OBJECT
+
 	SmallRock(int X, int Y, int xVel, int yVel, int phaseFreq);
 	~SmallRock() {
 		--gNumRocks;
@@ -383,6 +401,8 @@ error("-   Small rock! (%d)\n", gNumRocks);
 class MediumRock : public Object {
 
 public:
+	POOLED_OBJECT
+
 	MediumRock(int X, int Y, int xVel, int yVel, int phaseFreq);
 	~MediumRock() {
 		--gNumRocks;
@@ -440,6 +460,8 @@ error("--  Medium rock! (%d)\n", gNumRocks);
 class LargeRock : public Object {
 
 public:
+	POOLED_OBJECT
+
 	LargeRock(int X, int Y, int xVel, int yVel, int phaseFreq);
 	~LargeRock() {
 		--gNumRocks;
@@ -497,6 +519,8 @@ error("--- Large rock! (%d)\n", gNumRocks);
 class SteelRoid : public Object {
 
 public:
+	POOLED_OBJECT
+
 	SteelRoid(int X, int Y, int xVel, int yVel);
 	~SteelRoid() { }
 
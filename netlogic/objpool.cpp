@@ -0,0 +1,60 @@
+
+#include "Maelstrom_Globals.h"
+#include "objpool.h"
+
+
+ObjectPool *ObjectPool::pools = NULL;
+
+ObjectPool:: ObjectPool(const char *poolname, size_t objsize, int count)
+{
+	int i;
+
+	name = poolname;
+	capacity = count;
+	memset(&stats, 0, sizeof(stats));
+
+	/* Room for the free list link in each, aligned for anything */
+	size = (objsize+15) & ~15;
+	slab = new Uint8[size*capacity];
+	freelist = NULL;
+	for ( i=capacity-1; i>=0; --i ) {
+		*(void **)(slab+i*size) = freelist;
+		freelist = slab+i*size;
+	}
+
+	next = pools;
+	pools = this;
+}
+
+void *
+ObjectPool:: Alloc(size_t objsize)
+{
+	void *mem;
+
+	if ( freelist && (objsize <= size) ) {
+		mem = freelist;
+		freelist = *(void **)mem;
+	} else {
+		mem = ::operator new(objsize);
+		++stats.overflows;
+	}
+	if ( ++stats.live > stats.peak ) {
+		stats.peak = stats.live;
+	}
+	return(mem);
+}
+
+void
+ObjectPool:: Free(void *mem)
+{
+	if ( mem == NULL ) {
+		return;
+	}
+	if ( ((Uint8 *)mem >= slab) && ((Uint8 *)mem < slab+size*capacity) ) {
+		*(void **)mem = freelist;
+		freelist = mem;
+	} else {
+		::operator delete(mem);
+	}
+	--stats.live;
+}
@@ -0,0 +1,71 @@
+
+#ifndef _objpool_h
+#define _objpool_h
+
+/* Pools of the objects made and destroyed in the middle of a frame:
+
+   Each kind of object has a slab with room for a fixed number of them,
+   made at startup, and hands them out from a list of the free ones, so
+   rocks splitting or a ship blowing up during hit detection doesn't go
+   to the heap.  If a pool runs out, or is asked for something bigger
+   than its objects, that one comes from the heap as before.  All the
+   pools are kept in a list, for reporting how many they gave out.
+*/
+
+typedef struct {
+	Uint32 live;		/* Objects given out now */
+	Uint32 peak;		/* The most given out at once */
+	Uint32 overflows;	/* Objects that came from the heap instead */
+} ObjectPoolStats;
+
+class ObjectPool {
+
+public:
+	ObjectPool(const char *name, size_t size, int capacity);
+
+	void *Alloc(size_t size);
+	void Free(void *mem);
+
+	const char *Name(void) {
+		return(name);
+	}
+	int Capacity(void) {
+		return(capacity);
+	}
+	const ObjectPoolStats *Stats(void) {
+		return(&stats);
+	}
+
+	/* The list of all the pools */
+	static ObjectPool *First(void) {
+		return(pools);
+	}
+	ObjectPool *Next(void) {
+		return(next);
+	}
+
+private:
+	const char *name;
+	int capacity;
+	size_t size;
+	Uint8 *slab;
+	void *freelist;
+	ObjectPoolStats stats;
+
+	static ObjectPool *pools;
+	ObjectPool *next;
+};
+
+/* This goes in a class to give out its objects, and those of the classes
+   derived from it, from 'Class::pool'.
+ */
+#define POOLED_OBJECT							\
+	static ObjectPool pool;						\
+	void *operator new(size_t size) {				\
+		return(pool.Alloc(size));				\
+	}								\
+	void operator delete(void *mem) {				\
+		pool.Free(mem);						\
+	}
+
+#endif /* _objpool_h */
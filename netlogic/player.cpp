@@ -28,6 +28,7 @@ Player:: Player(int index) : Object(0, 0, 0, 0, gPlayerShip, NO_PHASE_CHANGE)
 {
 	int i;
 
+	MovesItself();
 	Index = index;
 	Score = 0;
 	for ( i=0; i<MAX_SHOTS; ++i ) {
@@ -80,7 +81,7 @@ Player::NewWave(void)
 	AutoShield = SAFE_TIME;
 	WasShielded = 0;
 	Sphase = 0;
-	SetPos(
+	Place(
 		((SCREEN_WIDTH/2-((gNumPlayers/2-Index)*(2*SPRITES_WIDTH)))
 							*SCALE_FACTOR),
 		((SCREEN_HEIGHT/2)*SCALE_FACTOR)
@@ -124,6 +125,10 @@ Player::NewShip(void)
 	Dead = 0;
 	Exploding = 0;
 	Set_TTL(-1);
+
+	/* It hasn't moved while it was dead */
+	lastx = x;
+	lasty = y;
 	if ( ! gDeathMatch )
 		--Lives;
 	return(Lives);
@@ -206,7 +211,7 @@ int
 Player::BeenTimedOut(void)
 {
 	Exploding = 0;
-	SetPos(
+	Place(
 		((SCREEN_WIDTH/2-((gNumPlayers/2-Index)*(2*SPRITES_WIDTH)))
 							*SCALE_FACTOR),
 		((SCREEN_HEIGHT/2)*SCALE_FACTOR)
@@ -298,11 +303,36 @@ Player::ShotHit(Rect *hitRect)
 	}
 	return(NULL);
 }
+void
+Player::MarkHits(HitGrid *grid)
+{
+	int i;
+
+	OBJ_LOOP(i, numshots)
+		grid->Add(&shots[i]->hitRect);
+	Object::MarkHits(grid);
+}
 int 
 Player::Move(int Freeze)
 {
 	int i;
 
+	/* Flicker the thrust and the shield shown last frame */
+	if ( Alive() ) {
+		if ( WasThrusting ) {
+			if ( ThrustBlit == gThrust1 )
+				ThrustBlit = gThrust2;
+			else
+				ThrustBlit = gThrust1;
+		}
+		if ( WasShielded ) {
+			if ( Sphase )
+				Sphase = 0;
+			else
+				Sphase = 1;
+		}
+	}
+
 	/* Move and time out old shots */
 #ifdef SERIOUS_DEBUG
 printf("Shots(%d): ", numshots);
@@ -541,69 +571,42 @@ Player::HandleKeys(void)
 }
 
 void 
-Player::BlitSprite(void)
+Player::BlitSprite(int frac)
 {
-	int i;
+	int i, X, Y;
 
 	if ( ! Alive() )
 		return;
 
 	/* Draw the new shots */
 	OBJ_LOOP(i, numshots) {
-		int X = (shots[i]->x>>SPRITE_PRECISION);
-		int Y = (shots[i]->y>>SPRITE_PRECISION);
-		screen->QueueBlit(X, Y, gPlayerShot);
+		X = BlendShot(shots[i]->x, shots[i]->xvel,
+				playground.left, playground.right, frac);
+		Y = BlendShot(shots[i]->y, shots[i]->yvel,
+				playground.top, playground.bottom, frac);
+		screen->QueueSprite(X>>SPRITE_PRECISION, Y>>SPRITE_PRECISION,
+								gPlayerShot);
 	}
+	X = BlendX(frac);
+	Y = BlendY(frac);
+
 	/* Draw the shield, if necessary */
 	if ( AutoShield || (ShieldOn && (ShieldLevel > 0)) ) {
-		screen->QueueBlit(x>>SPRITE_PRECISION, y>>SPRITE_PRECISION,
-						gShieldBlit->sprite[Sphase]);
+		screen->QueueSprite(X>>SPRITE_PRECISION, Y>>SPRITE_PRECISION,
+						&gShieldBlit->sprite[Sphase]);
 	}
 	/* Draw the thrust, if necessary */
 	if ( Thrusting && ! NoThrust ) {
 		int thrust_x, thrust_y;
-		thrust_x = x + gThrustOrigins[phase].h;
-		thrust_y = y + gThrustOrigins[phase].v;
-		screen->QueueBlit(thrust_x>>SPRITE_PRECISION,
+		thrust_x = X + gThrustOrigins[phase].h;
+		thrust_y = Y + gThrustOrigins[phase].v;
+		screen->QueueSprite(thrust_x>>SPRITE_PRECISION,
 					thrust_y>>SPRITE_PRECISION,
-						ThrustBlit->sprite[phase]);
+						&ThrustBlit->sprite[phase]);
 	}
 	
 	/* Draw our ship */
-	Object::BlitSprite();
-}
-void 
-Player::UnBlitSprite(void)
-{
-	int i;
-
-	if ( ! Alive() )
-		return;
-
-	/* Erase all old shots */
-	OBJ_LOOP(i, numshots) {
-		int X = (shots[i]->x>>SPRITE_PRECISION);
-		int Y = (shots[i]->y>>SPRITE_PRECISION);
-		screen->Clear(X, Y, SHOT_SIZE, SHOT_SIZE, DOCLIP);
-	}
-	/* Erase the thrust, if necessary */
-	if ( WasThrusting ) {
-		int thrust_x, thrust_y;
-		thrust_x = (x + gThrustOrigins[phase].h)>>SPRITE_PRECISION;
-		thrust_y = (y + gThrustOrigins[phase].v)>>SPRITE_PRECISION;
-		screen->Clear(thrust_x, thrust_y, 16, 16, DOCLIP);
-		if ( ThrustBlit == gThrust1 )
-			ThrustBlit = gThrust2;
-		else
-			ThrustBlit = gThrust1;
-	}
-	if ( WasShielded ) {
-		if ( Sphase )
-			Sphase = 0;
-		else
-			Sphase = 1;
-	}
-	Object::UnBlitSprite();
+	Object::BlitSprite(frac);
 }
 void 
 Player::HitSound(void)
@@ -33,10 +33,10 @@ public:
 	virtual int BeenTimedOut(void);
 	virtual int Explode(void);
 	virtual Shot *ShotHit(Rect *hitRect);
+	virtual void MarkHits(HitGrid *grid);
 	virtual int Move(int Freeze);
 	virtual void HandleKeys(void);
-	virtual void BlitSprite(void);
-	virtual void UnBlitSprite(void);
+	virtual void BlitSprite(int frac);
 
 	/* Small access functions */
 	virtual Uint32 Color(void) {
@@ -98,14 +98,14 @@ public:
 	virtual void HitSound(void);
 	virtual void ExplodeSound(void);
 
-	virtual void ShowDot(void) {
-		/* Draw our identity dot */
+	virtual void ShowDot(int frac) {
+		/* Draw our identity dot, on the ship as drawn */
 		int X, Y;
 		if ( ! Alive() ) {
 			return;
 		}
-		X = (x>>SPRITE_PRECISION)+12;
-		Y = (y>>SPRITE_PRECISION)+12;
+		X = (BlendX(frac)>>SPRITE_PRECISION)+12;
+		Y = (BlendY(frac)>>SPRITE_PRECISION)+12;
 		if ( (X > gClipRect.x) && (X < (gClipRect.x+gClipRect.w-4)) &&
 		     (Y > gClipRect.y) && (Y < (gClipRect.y+gClipRect.h-4)) ) {
 			screen->FillRect(X, Y, 4, 4, ship_color);
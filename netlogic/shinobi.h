@@ -4,8 +4,11 @@
 class Shinobi : public Object {
 
 public:
+	POOLED_OBJECT
+
 	Shinobi(int X, int Y, Blit *blit, int ShotOdds) :
 					Object(X, Y, 0, 0, blit, 1) {
+		MovesItself();
 		Set_Points(ENEMY_PTS);
 		Set_HitPoints(ENEMY_HITS);
 
@@ -45,6 +48,12 @@ public:
 	}
 
 
+	virtual void MarkHits(HitGrid *grid) {
+		int i;
+		OBJ_LOOP(i, numshots)
+			grid->Add(&shots[i]->hitRect);
+		Object::MarkHits(grid);
+	}
 	virtual Shot *ShotHit(Rect *hitRect) {
 		int i;
 		/* Shots are painless if we are exploding */
@@ -174,25 +183,18 @@ public:
 			alive = -1;
 		return(alive);
 	}
-	virtual void BlitSprite(void) {
+	virtual void BlitSprite(int frac) {
 		/* Draw the new shots */
 		int i;
 		OBJ_LOOP(i, numshots) {
-			int X = (shots[i]->x>>SPRITE_PRECISION);
-			int Y = (shots[i]->y>>SPRITE_PRECISION);
-			screen->QueueBlit(X, Y, gEnemyShot);
-		}
-		Object::BlitSprite();
-	}
-	virtual void UnBlitSprite(void) {
-		/* Erase all old shots */
-		int i;
-		OBJ_LOOP(i, numshots) {
-			int X = (shots[i]->x>>SPRITE_PRECISION);
-			int Y = (shots[i]->y>>SPRITE_PRECISION);
-			screen->Clear(X, Y, SHOT_SIZE, SHOT_SIZE, DOCLIP);
+			int X = BlendShot(shots[i]->x, shots[i]->xvel,
+				playground.left, playground.right, frac);
+			int Y = BlendShot(shots[i]->y, shots[i]->yvel,
+				playground.top, playground.bottom, frac);
+			screen->QueueSprite(X>>SPRITE_PRECISION,
+					Y>>SPRITE_PRECISION, gEnemyShot);
 		}
-		Object::UnBlitSprite();
+		Object::BlitSprite(frac);
 	}
 
 	virtual void HitSound(void) {
@@ -0,0 +1,254 @@
+
+#include "Maelstrom_Globals.h"
+#include "status.h"
+
+
+StatusLine:: StatusLine(MFont *textfont, Uint8 textstyle, Uint32 bgcolor)
+{
+	numwidgets = 0;
+	font = textfont;
+	style = textstyle;
+	background = bgcolor;
+}
+
+StatusLine:: ~StatusLine()
+{
+	StatusWidget *widget;
+	int i;
+
+	for ( i=0; i<numwidgets; ++i ) {
+		widget = &widgets[i];
+		if ( widget->image ) {
+			fontserv->FreeText(widget->image);
+		}
+		if ( widget->format ) {
+			delete[] widget->format;
+		}
+	}
+}
+
+StatusLine::StatusWidget *
+StatusLine:: NewWidget(int kind, int x, int y, int w, int h)
+{
+	StatusWidget *widget;
+
+	if ( numwidgets == STATUS_MAX_WIDGETS ) {
+		return(NULL);
+	}
+	widget = &widgets[numwidgets++];
+	memset(widget, 0, sizeof(*widget));
+	widget->kind = kind;
+	widget->x = x;
+	widget->y = y;
+	widget->w = w;
+	widget->h = h;
+	return(widget);
+}
+
+/* Replace the image of a text widget, keeping the old area to erase */
+void
+StatusLine:: SetText(StatusWidget *widget, const char *text)
+{
+	if ( widget->image ) {
+		fontserv->FreeText(widget->image);
+	}
+	widget->image = fontserv->TextImage(text, font, style,
+					widget->R, widget->G, widget->B);
+	widget->dirty = 1;
+}
+
+int
+StatusLine:: AddLabel(int x, int y, const char *text, Uint8 R, Uint8 G, Uint8 B)
+{
+	StatusWidget *widget;
+
+	widget = NewWidget(STATUS_TEXT, x, y, 0, 0);
+	if ( widget == NULL ) {
+		return(-1);
+	}
+	widget->R = R;
+	widget->G = G;
+	widget->B = B;
+	widget->valid = 1;
+	SetText(widget, text);
+	return(numwidgets-1);
+}
+
+int
+StatusLine:: AddNumber(int x, int y, const char *format,
+						Uint8 R, Uint8 G, Uint8 B)
+{
+	StatusWidget *widget;
+
+	widget = NewWidget(STATUS_TEXT, x, y, 0, 0);
+	if ( widget == NULL ) {
+		return(-1);
+	}
+	widget->format = new char[strlen(format)+1];
+	strcpy(widget->format, format);
+	widget->R = R;
+	widget->G = G;
+	widget->B = B;
+	return(numwidgets-1);
+}
+
+int
+StatusLine:: AddIcons(int x, int y, int w, int h,
+					SDL_Surface **icons, int numicons)
+{
+	StatusWidget *widget;
+	int i;
+
+	widget = NewWidget(STATUS_ICONS, x, y, w, h);
+	if ( widget == NULL ) {
+		return(-1);
+	}
+	if ( numicons > STATUS_MAX_ICONS ) {
+		numicons = STATUS_MAX_ICONS;
+	}
+	for ( i=0; i<numicons; ++i ) {
+		widget->icons[i] = icons[i];
+	}
+	widget->numicons = numicons;
+	return(numwidgets-1);
+}
+
+int
+StatusLine:: AddBar(int x, int y, int w, int h, int max,
+					Uint32 frame, Uint32 fill)
+{
+	StatusWidget *widget;
+
+	widget = NewWidget(STATUS_BAR, x, y, w, h);
+	if ( widget == NULL ) {
+		return(-1);
+	}
+	widget->max = max;
+	widget->frame = frame;
+	widget->fill = fill;
+	return(numwidgets-1);
+}
+
+int
+StatusLine:: AddSwatch(int x, int y, int w, int h)
+{
+	StatusWidget *widget;
+
+	widget = NewWidget(STATUS_SWATCH, x, y, w, h);
+	if ( widget == NULL ) {
+		return(-1);
+	}
+	return(numwidgets-1);
+}
+
+void
+StatusLine:: Set(int id, int value)
+{
+	StatusWidget *widget;
+	char text[128];
+
+	if ( (id < 0) || (id >= numwidgets) ) {
+		return;
+	}
+	widget = &widgets[id];
+	if ( widget->valid && (widget->value == value) ) {
+		return;
+	}
+	widget->value = value;
+	widget->valid = 1;
+	if ( widget->format ) {
+		SDL_snprintf(text, sizeof(text), widget->format, value);
+		SetText(widget, text);
+	} else {
+		widget->dirty = 1;
+	}
+}
+
+int
+StatusLine:: Width(int id)
+{
+	if ( (id < 0) || (id >= numwidgets) || !widgets[id].image ) {
+		return(0);
+	}
+	return(widgets[id].image->w);
+}
+
+void
+StatusLine:: Reset(void)
+{
+	int i;
+
+	for ( i=0; i<numwidgets; ++i ) {
+		if ( widgets[i].valid ) {
+			widgets[i].dirty = 1;
+		}
+	}
+}
+
+void
+StatusLine:: Draw(void)
+{
+	StatusWidget *widget;
+	SDL_Surface *icon;
+	int i, fact;
+
+	for ( i=0; i<numwidgets; ++i ) {
+		widget = &widgets[i];
+		if ( ! widget->dirty ) {
+			continue;
+		}
+		widget->dirty = 0;
+
+		switch (widget->kind) {
+			case STATUS_TEXT:
+				/* Erase the old text, and remember the new */
+				if ( widget->w ) {
+					screen->FillRect(widget->x,
+						widget->y-widget->h+2,
+						widget->w, widget->h,
+						background);
+				}
+				if ( widget->image ) {
+					widget->w = widget->image->w;
+					widget->h = widget->image->h;
+					screen->QueueBlit(widget->x,
+						widget->y-widget->h+2,
+						widget->image, NOCLIP);
+				} else {
+					widget->w = 0;
+				}
+				break;
+			case STATUS_ICONS:
+				if ( (widget->value >= 0) &&
+				     (widget->value < widget->numicons) ) {
+					icon = widget->icons[widget->value];
+				} else {
+					icon = NULL;
+				}
+				if ( icon ) {
+					screen->QueueBlit(widget->x, widget->y,
+							icon, NOCLIP);
+				} else {
+					screen->FillRect(widget->x, widget->y,
+						widget->w, widget->h,
+						background);
+				}
+				break;
+			case STATUS_BAR:
+				fact = ((widget->w-2) * widget->value) /
+								widget->max;
+				screen->DrawRect(widget->x, widget->y,
+					widget->w, widget->h, widget->frame);
+				screen->FillRect(widget->x+1, widget->y+1,
+					fact, widget->h-2, widget->fill);
+				screen->FillRect(widget->x+1+fact, widget->y+1,
+					widget->w-2-fact, widget->h-2,
+					background);
+				break;
+			case STATUS_SWATCH:
+				screen->FillRect(widget->x, widget->y,
+					widget->w, widget->h, widget->value);
+				break;
+		}
+	}
+}
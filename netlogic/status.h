@@ -0,0 +1,90 @@
+
+#ifndef _status_h
+#define _status_h
+
+/* The status line at the bottom of the game screen, as a set of widgets:
+
+   Each widget remembers the value it shows, and the text widgets keep
+   the image of their text.  Set() just compares the new value, rendering
+   the text only when it changed, and Draw() draws only the widgets that
+   changed since the last time, erasing the area they covered before.
+*/
+
+#define STATUS_MAX_WIDGETS	64
+#define STATUS_MAX_ICONS	8
+
+class StatusLine {
+
+public:
+	/* The text is drawn in 'font' and 'style', and the widgets are
+	   erased with the 'background' color.
+	 */
+	StatusLine(MFont *font, Uint8 style, Uint32 background);
+	~StatusLine();
+
+	/* These add a widget and return its id, or -1 if there's no room.
+	   Text is drawn with its baseline at 'y', like DrawText().
+	 */
+	int AddLabel(int x, int y, const char *text, Uint8 R, Uint8 G, Uint8 B);
+	int AddNumber(int x, int y, const char *format,
+						Uint8 R, Uint8 G, Uint8 B);
+	/* Shows icons[value], or nothing if it's out of range or NULL */
+	int AddIcons(int x, int y, int w, int h,
+					SDL_Surface **icons, int numicons);
+	/* A frame filled in proportion to the value, up to 'max' */
+	int AddBar(int x, int y, int w, int h, int max,
+					Uint32 frame, Uint32 fill);
+	/* An area filled with the value, as a color */
+	int AddSwatch(int x, int y, int w, int h);
+
+	/* Change the value shown by a widget, to be drawn by Draw() */
+	void Set(int id, int value);
+
+	/* The width of a widget, for the text as it is now */
+	int Width(int id);
+
+	/* Draw all the widgets again, after the screen was cleared */
+	void Reset(void);
+
+	/* Draw the widgets that changed */
+	void Draw(void);
+
+private:
+	enum {
+		STATUS_TEXT,
+		STATUS_ICONS,
+		STATUS_BAR,
+		STATUS_SWATCH
+	};
+	typedef struct {
+		int kind;
+		int x, y;		/* Text is drawn with its baseline at y */
+		int w, h;		/* The area covered, erased before drawing */
+		int value;
+		int valid;		/* Set when the value has been set */
+		int dirty;		/* Set when it needs to be drawn */
+
+		/* Text widgets */
+		char *format;		/* NULL for a label */
+		Uint8 R, G, B;
+		SDL_Surface *image;	/* Held from the font server */
+
+		/* Icon widgets */
+		SDL_Surface *icons[STATUS_MAX_ICONS];
+		int numicons;
+
+		/* Bar widgets */
+		int max;
+		Uint32 frame, fill;
+	} StatusWidget;
+	StatusWidget widgets[STATUS_MAX_WIDGETS];
+	int numwidgets;
+	MFont *font;
+	Uint8 style;
+	Uint32 background;
+
+	StatusWidget *NewWidget(int kind, int x, int y, int w, int h);
+	void SetText(StatusWidget *widget, const char *text);
+};
+
+#endif /* _status_h */
@@ -21,10 +21,15 @@
 
 #include "SDL_FrameBuf.h"
 #include "pixel.h"
+#include "convert.h"
+#include "capture.h"
 
 
-#define LOWER_PREC(X)	((X)/16)	/* Lower the precision of a value */
-#define RAISE_PREC(X)	((X)/16)	/* Raise the precision of a value */
+/* Convert the whole screen if the dirty areas cover this percentage of it,
+   or there are so many of them that uploading each one would cost more.
+ */
+#define FULL_UPDATE_COVERAGE	50
+#define FULL_UPDATE_RECTS	128
 
 #define MIN(A, B)	((A < B) ? A : B)
 #define MAX(A, B)	((A > B) ? A : B)
@@ -41,6 +46,29 @@
 	else								\
 	if ( Y > screen->h ) Y = screen->h;				\
 }
+#define CLAMPX(X)							\
+{									\
+	if ( X < 0 ) X = 0;						\
+	else								\
+	if ( X >= screen->w ) X = screen->w-1;				\
+}
+#define CLAMPY(Y)							\
+{									\
+	if ( Y < 0 ) Y = 0;						\
+	else								\
+	if ( Y >= screen->h ) Y = screen->h-1;				\
+}
+
+/* Call the version of a drawing primitive for the surface pixel size */
+#define DRAW_BPP(SURFACE, FUNC, ARGS)					\
+{									\
+	switch (SURFACE->format->BytesPerPixel) {			\
+		case 1: FUNC<1> ARGS; break;				\
+		case 2: FUNC<2> ARGS; break;				\
+		case 3: FUNC<3> ARGS; break;				\
+		case 4: FUNC<4> ARGS; break;				\
+	}								\
+}
 
 /* Constructors cannot fail. :-/ */
 FrameBuf:: FrameBuf()
@@ -54,12 +82,38 @@ FrameBuf:: FrameBuf()
 	screenbg = NULL;
 	palette = NULL;
 	blitQ = NULL;
-	dirtymap = NULL;
+	spriteQ = NULL;
+	lastsprites = NULL;
+	spriterects = NULL;
+	sprite_frame = 0;
 	updatelist = NULL;
 	errstr = NULL;
 	faded = 0;
+	fade_level = FRAMEBUF_FADE_STEPS;
+	fade_duration = 0;
+	colormap = fademaps[fade_level];
+	options = FRAMEBUF_DIRTYUPDATE;
+	full_update = 1;
+	in_frame = 0;
+	scale = scale_request = 1;
+	bands = NULL;
+	capture = NULL;
+	capture_full = 0;
+	render_thread = NULL;
+	render_ready = NULL;
+	render_lock = NULL;
+	render_done = NULL;
+	render_pixels = NULL;
+	render_rects = NULL;
+	for ( int i = 0; i < RENDER_SLOTS; ++i ) {
+		render_slots[i].pixels = NULL;
+	}
+	ResetStats();
 	images.next = NULL;
 	itail = &images;
+	areas = new SurfacePool(ReleaseImage);
+	atlas = NULL;
+	atlas_opaque = NULL;
 }
 
 static void PrintSurface(const char *title, SDL_Surface *surface)
@@ -80,52 +134,49 @@ int
 FrameBuf:: Init(int width, int height, Uint32 video_flags,
 					SDL_Color *colors, SDL_Surface *icon)
 {
-	window = SDL_CreateWindow( "", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, video_flags);
-	if ( window == NULL )
-	{
-		SetError("Couldn't create window: %s", SDL_GetError());
-		return(-1);
-	}
-
-	/* Set the icon, if any */
-	if ( icon ) {
-		SDL_SetWindowIcon(window, icon);
-	}
+	/* A headless frame buffer draws the same way, but shows nothing */
+	if ( !(options & FRAMEBUF_HEADLESS) ) {
+		window = SDL_CreateWindow( "", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, video_flags);
+		if ( window == NULL )
+		{
+			SetError("Couldn't create window: %s", SDL_GetError());
+			return(-1);
+		}
 
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
-	if ( renderer == NULL ) {
-		SetError("Couldn't create renderer: %s", SDL_GetError());
-		return(-1);
+		/* Set the icon, if any */
+		if ( icon ) {
+			SDL_SetWindowIcon(window, icon);
+		}
+		SDL_AddEventWatch(WatchEvent, this);
 	}
 
-	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
-	if ( texture == NULL ) {
-		SetError("Couldn't create texture: %s", SDL_GetError());
-		return(-1);
+	if ( options & FRAMEBUF_NATIVE32 ) {
+		/* Drawn in the texture's format, to be copied as it is */
+		screenfg = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+						SDL_PIXELFORMAT_ARGB8888);
+	} else {
+		screenfg = SDL_CreateRGBSurface(0, width, height, 8, 0, 0, 0, 0);
 	}
-	SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
-
-	SDL_RenderSetLogicalSize(renderer, width, height);
-
-	screenfg = SDL_CreateRGBSurface(0, width, height, 8, 0, 0, 0, 0);
 	if ( screenfg == NULL ) {
 		SetError("Couldn't create foreground: %s", SDL_GetError());
 		return(-1);
 	}
+	SDL_SetSurfaceBlendMode(screenfg, SDL_BLENDMODE_NONE);
 	FocusFG();
 	PrintSurface("Created foreground", screenfg);
 
 	/* Create the background */
-	screenbg = SDL_CreateRGBSurface(screen->flags, screen->w, screen->h,
+	screenbg = SDL_CreateRGBSurfaceWithFormat(screen->flags,
+					screen->w, screen->h,
 					screen->format->BitsPerPixel,
-					screen->format->Rmask,
-					screen->format->Gmask,
-					screen->format->Bmask, 0);
+					screen->format->format);
 	if ( screenbg == NULL ) {
 		SetError("Couldn't create background: %s", SDL_GetError());
 		return(-1);
 	}
+	SDL_SetSurfaceBlendMode(screenbg, SDL_BLENDMODE_NONE);
 	PrintSurface("Created background", screenbg);
+	BuildSpans(screenbg, 0, 0);
 
 	/* Create the staging surface */
 	staging = SDL_CreateRGBSurfaceWithFormatFrom(NULL, width, height, 32, 0, SDL_PIXELFORMAT_ARGB8888);
@@ -135,7 +186,7 @@ FrameBuf:: Init(int width, int height, Uint32 video_flags,
 	}
 	PrintSurface("Created staging", screenbg);
 
-	/* Create the palette */
+	/* Create the palette, a 32-bit screen just maps artwork with it */
 	if ( colors ) {
 		palette = SDL_AllocPalette(256);
 		if ( palette == NULL ) {
@@ -143,24 +194,32 @@ FrameBuf:: Init(int width, int height, Uint32 video_flags,
 			return(-1);
 		}
 
-		SDL_SetSurfacePalette(screenfg, palette);
-		SDL_SetSurfacePalette(screenbg, palette);
+		if ( screenfg->format->palette ) {
+			SDL_SetSurfacePalette(screenfg, palette);
+			SDL_SetSurfacePalette(screenbg, palette);
+		}
 	}
 	
-	/* Create a dirty rectangle map of the screen */
-	dirtypitch = LOWER_PREC(width);
-	dirtymaplen = LOWER_PREC(height)*dirtypitch;
-	dirtymap   = new SDL_Rect *[dirtymaplen];
-
-	/* Create the update list */
-	updatelist = new SDL_Rect[UPDATE_CHUNK];
+	/* Create a dirty tile map of the screen and the update list */
+	dirtytiles.Init(width, height);
+	pendingtiles.Init(width, height);
+	updatelist = new SDL_Rect[dirtytiles.MaxRects()];
 	ClearDirtyList();
-	updatemax = UPDATE_CHUNK;
 
 	/* Create the blit list */
 	blitQ = new BlitQ[QUEUE_CHUNK];
 	blitQlen = 0;
 	blitQmax = QUEUE_CHUNK;
+
+	/* Create the sprite lists, and the tiles they are composed in */
+	spriteQ = new BlitQ[QUEUE_CHUNK];
+	spriteQlen = 0;
+	spriteQmax = QUEUE_CHUNK;
+	lastsprites = new SDL_Rect[QUEUE_CHUNK];
+	lastspriteslen = 0;
+	lastspritesmax = QUEUE_CHUNK;
+	spritetiles.Init(width, height);
+	spriterects = new SDL_Rect[spritetiles.MaxRects()];
 	
 	/* Set the blit clipping rectangle */
 	clip.x = 0;
@@ -174,20 +233,107 @@ FrameBuf:: Init(int width, int height, Uint32 video_flags,
 		SetPalette(colors);
 	}
 
-	/* Figure out what putpixel routine to use */
-	switch (screen->format->BytesPerPixel) {
-		case 1:
-			PutPixel = PutPixel1;
-			break;
-		case 2:
-			PutPixel = PutPixel2;
-			break;
-		case 3:
-			PutPixel = PutPixel3;
-			break;
-		case 4:
-			PutPixel = PutPixel4;
-			break;
+	/* Pick the fastest palette expansion the CPU supports */
+	kernel = BestConvertKernel();
+
+	if ( options & FRAMEBUF_BANDCONVERT ) {
+		SetupBands();
+	}
+
+	if ( options & FRAMEBUF_HEADLESS ) {
+		return(0);
+	}
+
+	if ( CreateRenderer() < 0 ) {
+		return(-1);
+	}
+	if ( options & FRAMEBUF_RENDERTHREAD ) {
+		return(TryRenderThread());
+	}
+	return(0);
+}
+
+int
+FrameBuf:: CreateRenderer(void)
+{
+	Uint32 flags;
+	int w, h, fits, shown;
+
+	/* The render thread paces the presents itself, see PresentConverted() */
+	if ( options & FRAMEBUF_RENDERTHREAD ) {
+		flags = 0;
+	} else {
+		flags = SDL_RENDERER_PRESENTVSYNC;
+	}
+	renderer = SDL_CreateRenderer(window, -1, flags);
+	if ( renderer == NULL ) {
+		SetError("Couldn't create renderer: %s", SDL_GetError());
+		return(-1);
+	}
+
+	/* Scale 0 picks the largest whole scale that fits the output */
+	if ( SDL_GetRendererOutputSize(renderer, &w, &h) < 0 ) {
+		w = screenfg->w;
+		h = screenfg->h;
+	}
+	scale = scale_request;
+	if ( scale <= 0 ) {
+		scale = SDL_min(w/screenfg->w, h/screenfg->h);
+	}
+	scale = SDL_max(1, SDL_min(scale, CONVERT_MAX_SCALE));
+	fits = ((screenfg->w*scale <= w) && (screenfg->h*scale <= h));
+	shown = scale;
+
+	/* A 32-bit screen is copied as it is, the renderer scales it */
+	if ( options & FRAMEBUF_NATIVE32 ) {
+		scale = 1;
+	}
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, screenfg->w*scale, screenfg->h*scale);
+	if ( texture == NULL ) {
+		SetError("Couldn't create texture: %s", SDL_GetError());
+		DestroyRenderer();
+		return(-1);
+	}
+	if ( (shown > 1) && fits ) {
+		/* The texture is shown at a whole multiple of its size */
+		SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+		SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
+	} else {
+		SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+	}
+
+	/* The mouse is reported in screen pixels, whatever the scale */
+	SDL_RenderSetLogicalSize(renderer, screenfg->w, screenfg->h);
+	return(0);
+}
+
+void
+FrameBuf:: DestroyRenderer(void)
+{
+	if ( texture ) {
+		SDL_DestroyTexture(texture);
+		texture = NULL;
+	}
+	if ( renderer ) {
+		SDL_DestroyRenderer(renderer);
+		renderer = NULL;
+	}
+}
+
+/* Make the renderer again, for a new scale or to start or stop waiting
+   for the vertical blank, restarting the render thread if it's wanted.
+ */
+int
+FrameBuf:: ResetRenderer(void)
+{
+	StopRenderThread();
+	DestroyRenderer();
+	if ( CreateRenderer() < 0 ) {
+		return(-1);
+	}
+	if ( options & FRAMEBUF_RENDERTHREAD ) {
+		return(TryRenderThread());
 	}
 	return(0);
 }
@@ -196,32 +342,57 @@ FrameBuf:: ~FrameBuf()
 {
 	image_list *ielem, *iold;
 
+	StopRenderThread();
+	if ( StopCapture() < 0 ) {
+		fprintf(stderr, "Warning: %s\n", Error());
+	}
+	if ( bands )
+		delete bands;
 	for ( ielem = images.next; ielem; ) {
 		iold = ielem;
 		ielem = ielem->next;
-		SDL_FreeSurface(iold->image);
+		ReleaseImage(iold->image);
 		delete iold;
 	}
+	delete areas;
+	if ( atlas_opaque )
+		delete[] atlas_opaque;
 	if ( palette )
 		SDL_FreePalette(palette);
 	if ( screenfg )
 		SDL_FreeSurface(screenfg);
 	if ( screenbg )
-		SDL_FreeSurface(screenbg);
+		ReleaseImage(screenbg);
 	if ( staging )
 		SDL_FreeSurface(staging);
 	if ( blitQ )
 		delete[] blitQ;
-	if ( dirtymap )
-		delete[] dirtymap;
+	if ( spriteQ )
+		delete[] spriteQ;
+	if ( lastsprites )
+		delete[] lastsprites;
+	if ( spriterects )
+		delete[] spriterects;
 	if ( updatelist )
 		delete[] updatelist;
-	if ( texture )
-		SDL_DestroyTexture(texture);
-	if ( renderer )
-		SDL_DestroyRenderer(renderer);
-	if ( window )
+	DestroyRenderer();
+	if ( window ) {
+		SDL_DelEventWatch(WatchEvent, this);
 		SDL_DestroyWindow(window);
+	}
+}
+
+int SDLCALL
+FrameBuf:: WatchEvent(void *userdata, SDL_Event *event)
+{
+	FrameBuf *fb = (FrameBuf *)userdata;
+
+	/* The texture contents are gone, upload the whole screen again */
+	if ( (event->type == SDL_RENDER_TARGETS_RESET) ||
+	     (event->type == SDL_RENDER_DEVICE_RESET) ) {
+		fb->full_update = 1;
+	}
+	return(1);
 }
 
 /* Setup routines */
@@ -230,15 +401,102 @@ FrameBuf:: SetPalette(SDL_Color *colors)
 {
 	SDL_SetPaletteColors(palette, colors, 0, 256);
 
-	for ( int i = 0; i < 256; ++i ) {
-		Uint8 r = palette->colors[i].r;
-		Uint8 g = palette->colors[i].g;
-		Uint8 b = palette->colors[i].b;
-		colormap[i] = SDL_MapRGB(staging->format, r, g, b);
+	/* Map the palette at every fade level, so fading just picks a map */
+	for ( int v = 0; v <= FRAMEBUF_FADE_STEPS; ++v ) {
+		for ( int i = 0; i < 256; ++i ) {
+			Uint8 r = (Uint8)(palette->colors[i].r * v /
+							FRAMEBUF_FADE_STEPS);
+			Uint8 g = (Uint8)(palette->colors[i].g * v /
+							FRAMEBUF_FADE_STEPS);
+			Uint8 b = (Uint8)(palette->colors[i].b * v /
+							FRAMEBUF_FADE_STEPS);
+			fademaps[v][i] = SDL_MapRGB(staging->format, r, g, b);
+		}
 	}
+	full_update = 1;
 
 	SetBackground(BGrgb[0], BGrgb[1], BGrgb[2]);
 }
+int
+FrameBuf:: SetOptions(Uint32 flags)
+{
+	Uint32 changed;
+
+	/* Whether there is a display, and its depth, are decided by Init() */
+	if ( screenfg ) {
+		flags &= ~(FRAMEBUF_HEADLESS|FRAMEBUF_NATIVE32);
+		flags |= (options & (FRAMEBUF_HEADLESS|FRAMEBUF_NATIVE32));
+	}
+	if ( flags & FRAMEBUF_HEADLESS ) {
+		flags &= ~FRAMEBUF_RENDERTHREAD;
+	}
+	if ( flags & FRAMEBUF_NATIVE32 ) {
+		flags &= ~FRAMEBUF_BANDCONVERT;
+	}
+	changed = (options ^ flags);
+	options = flags;
+	full_update = 1;
+
+	/* Before Init() the options are just remembered */
+	if ( !(changed & (FRAMEBUF_RENDERTHREAD|FRAMEBUF_BANDCONVERT)) ||
+	     !screenfg ) {
+		return(0);
+	}
+
+	/* The render thread may be using the conversion threads */
+	StopRenderThread();
+	if ( changed & FRAMEBUF_BANDCONVERT ) {
+		SetupBands();
+	}
+	if ( changed & FRAMEBUF_RENDERTHREAD ) {
+		/* Only the renderer without the thread waits for vblank */
+		return(ResetRenderer());
+	}
+	if ( options & FRAMEBUF_RENDERTHREAD ) {
+		return(TryRenderThread());
+	}
+	return(0);
+}
+int
+FrameBuf:: SetScale(int factor)
+{
+	scale_request = factor;
+	full_update = 1;
+	if ( !screenfg || (options & FRAMEBUF_HEADLESS) ) {
+		return(0);
+	}
+
+	/* The render thread converts to the size of the texture */
+	return(ResetRenderer());
+}
+int
+FrameBuf:: RefreshRate(void)
+{
+	SDL_DisplayMode mode;
+
+	if ( !window || (SDL_GetWindowDisplayMode(window, &mode) < 0) ||
+	     (mode.refresh_rate <= 0) ) {
+		return(60);
+	}
+	return(mode.refresh_rate);
+}
+void
+FrameBuf:: SetupBands(void)
+{
+	if ( options & FRAMEBUF_BANDCONVERT ) {
+		if ( ! bands ) {
+			bands = new ConvertBands;
+			if ( bands->Init() < 0 ) {
+				delete bands;
+				bands = NULL;
+				options &= ~FRAMEBUF_BANDCONVERT;
+			}
+		}
+	} else if ( bands ) {
+		delete bands;
+		bands = NULL;
+	}
+}
 void
 FrameBuf:: SetBackground(Uint8 R, Uint8 G, Uint8 B)
 {
@@ -275,11 +533,23 @@ void
 FrameBuf:: PerformBlits(void)
 {
 	if ( blitQlen > 0 ) {
+		SDL_Surface *src;
+
 		/* Blast and free the queued blits */
 		for ( int i=0; i<blitQlen; ++i ) {
-			SDL_LowerBlit(blitQ[i].src, &blitQ[i].srcrect,
+			src = blitQ[i].src;
+			if ( src->userdata ) {
+				BlitSpans(src, &blitQ[i].srcrect,
+						&blitQ[i].dstrect);
+			} else {
+				SDL_LowerBlit(src, &blitQ[i].srcrect,
 						screen, &blitQ[i].dstrect);
-			SDL_FreeSurface(blitQ[i].src);
+			}
+			if ( src->refcount > 1 ) {
+				--src->refcount;
+			} else {
+				ReleaseImage(src);
+			}
 		}
 		blitQlen = 0;
 	}
@@ -287,41 +557,582 @@ FrameBuf:: PerformBlits(void)
 void
 FrameBuf:: Update(int auto_update)
 {
-	int i;
+	int i, present;
 
-	/* Blit and update the changed rectangles */
+	/* Blit and compose the changed rectangles */
 	PerformBlits();
+	if ( sprite_frame && (screen == screenfg) ) {
+		ComposeSprites();
+	}
+	present = 0;
 	if ( (screen == screenbg) && auto_update ) {
-		for ( i=0; i<updatelen; ++i ) {
-			SDL_LowerBlit(screenbg, &updatelist[i],
-			 		screenfg, &updatelist[i]);
+		if ( exactlen <= EXACT_RECTS ) {
+			for ( i=0; i<exactlen; ++i ) {
+				SDL_LowerBlit(screenbg, &exactlist[i],
+						screenfg, &exactlist[i]);
+			}
+		} else {
+			updatelen = dirtytiles.Build(updatelist);
+			for ( i=0; i<updatelen; ++i ) {
+				SDL_LowerBlit(screenbg, &updatelist[i],
+						screenfg, &updatelist[i]);
+			}
 		}
-		UpdateScreen();
+		pendingtiles.Merge(&dirtytiles);
+		present = 1;
 	} else if ( screen == screenfg ) {
-		UpdateScreen();
+		pendingtiles.Merge(&dirtytiles);
+		present = 1;
+	} else if ( dirty_fg ) {
+		/* Foreground changes are being dropped, catch up later */
+		full_update = 1;
+		capture_full = 1;
 	}
 	ClearDirtyList();
+
+	/* The frame is presented all at once by EndFrame() */
+	if ( present && !in_frame ) {
+		Present();
+
+		/* Nothing may follow it, so don't leave it a frame late */
+		PresentConverted(1);
+	}
+}
+void
+FrameBuf:: EndFrame(void)
+{
+	if ( ! in_frame ) {
+		/* Nothing was drawn, but a fade under way goes on */
+		AdvanceFade();
+		if ( full_update ) {
+			Present();
+		} else {
+			/* A frame left for a later refresh is shown now */
+			PresentConverted(0);
+		}
+		return;
+	}
+	PerformBlits();
+	if ( screen == screenfg ) {
+		if ( sprite_frame ) {
+			ComposeSprites();
+		}
+		pendingtiles.Merge(&dirtytiles);
+		ClearDirtyList();
+	}
+	in_frame = 0;
+	Present();
+	++stats.frames;
+}
+void
+FrameBuf:: Present(void)
+{
+	AdvanceFade();
+	updatelen = pendingtiles.Build(updatelist);
+	pendingtiles.Clear();
+	UpdateScreen();
+}
+void
+FrameBuf:: ConvertArea(const SDL_Rect *area, const Uint8 *src, int srcpitch,
+			const Uint32 *map, Uint8 *pixels, int pitch)
+{
+	int row;
+
+	if ( options & FRAMEBUF_NATIVE32 ) {
+		/* The screen is in the texture's format already */
+		src += area->y*srcpitch + area->x*4;
+		for ( row=0; row<area->h; ++row ) {
+			memcpy(pixels, src, area->w*4);
+			src += srcpitch;
+			pixels += pitch;
+		}
+		return;
+	}
+
+	src += area->y*srcpitch + area->x;
+	if ( bands && ((area->w*area->h*scale*scale) >=
+					CONVERT_BAND_THRESHOLD) ) {
+		bands->Convert(kernel, src, srcpitch, map,
+				pixels, pitch, area->w, area->h, scale);
+	} else {
+		ConvertRows(kernel, src, srcpitch, map,
+				pixels, pitch, area->w, area->h, scale);
+	}
 }
 void
 FrameBuf:: UpdateScreen(void)
 {
-	if ( SDL_LockTexture(texture, NULL, &staging->pixels, &staging->pitch) == 0 ) {
-		int w = staging->w;
-		int h = staging->h;
-		int row, col;
+	if ( capture ) {
+		capture->AddFrame(screenfg, updatelist, updatelen,
+						capture_full, colormap);
+		capture_full = 0;
+	}
+	if ( options & FRAMEBUF_HEADLESS ) {
+		/* The frame is finished, there's just nowhere to show it */
+		full_update = 0;
+		++stats.presents;
+	} else if ( render_thread ) {
+		/* Show the last frame, converted while this one was drawn */
+		PresentConverted(0);
+		HandOver();
+	} else {
+		full_update = RenderScreen((Uint8 *)screenfg->pixels,
+			screenfg->pitch, colormap, fade_level,
+			updatelist, updatelen,
+			full_update || !(options & FRAMEBUF_DIRTYUPDATE),
+								&stats);
+	}
+	if ( in_frame ) {
+		++stats.extra_presents;
+	}
+}
+
+/* See if it's worth uploading only the changed areas */
+int
+FrameBuf:: WholeScreen(const SDL_Rect *rects, int numrects)
+{
+	int i, coverage;
+
+	if ( numrects > FULL_UPDATE_RECTS ) {
+		return(1);
+	}
+	coverage = 0;
+	for ( i=0; i<numrects; ++i ) {
+		coverage += rects[i].w*rects[i].h;
+	}
+	return((coverage*100) >= (screenfg->w*screenfg->h*FULL_UPDATE_COVERAGE));
+}
+
+/* Upload the changed areas of a frame to the texture and present it,
+   converting 8-bit pixels with the map, or fading 32-bit ones to the level.
+   This returns whether the next frame still needs a full update.
+ */
+int
+FrameBuf:: RenderScreen(const Uint8 *pixels, int pitch, const Uint32 *map,
+			int fade, SDL_Rect *rects, int numrects, int full,
+						FrameBufStats *counts)
+{
+	SDL_Rect screen_area, area, texture_area;
+	int i;
+	Uint8 level;
+
+	screen_area.x = 0;
+	screen_area.y = 0;
+	screen_area.w = screenfg->w;
+	screen_area.h = screenfg->h;
 
-		for ( row = 0; row < h; ++row ) {
-			Uint8 *src = (Uint8 *)screenfg->pixels + row * screenfg->pitch;
-			Uint32 *dst = (Uint32 *)((Uint8 *)staging->pixels + row * staging->pitch);
-			for ( col = 0; col < w; ++col ) {
-				*dst++ = colormap[ *src++ ];
+	if ( ! full ) {
+		full = WholeScreen(rects, numrects);
+	}
+	if ( full ) {
+		if ( SDL_LockTexture(texture, NULL,
+				&staging->pixels, &staging->pitch) == 0 ) {
+			ConvertArea(&screen_area, pixels, pitch, map,
+				(Uint8 *)staging->pixels, staging->pitch);
+			SDL_UnlockTexture(texture);
+			counts->converted +=
+				screen_area.w*screen_area.h*scale*scale;
+			full = 0;
+		}
+		++counts->full_updates;
+	} else {
+		/* The locked area is write-only, but we replace all of it */
+		for ( i=0; i<numrects; ++i ) {
+			if ( ! SDL_IntersectRect(&rects[i], &screen_area,
+								&area) ) {
+				continue;
+			}
+			texture_area.x = area.x*scale;
+			texture_area.y = area.y*scale;
+			texture_area.w = area.w*scale;
+			texture_area.h = area.h*scale;
+			if ( SDL_LockTexture(texture, &texture_area,
+				&staging->pixels, &staging->pitch) == 0 ) {
+				ConvertArea(&area, pixels, pitch, map,
+				(Uint8 *)staging->pixels, staging->pitch);
+				SDL_UnlockTexture(texture);
+				counts->converted +=
+					texture_area.w*texture_area.h;
 			}
 		}
-		SDL_UnlockTexture(texture);
+	}
+	if ( options & FRAMEBUF_NATIVE32 ) {
+		level = (Uint8)((fade * 255) / FRAMEBUF_FADE_STEPS);
+		SDL_SetTextureColorMod(texture, level, level, level);
 	}
 	SDL_RenderClear(renderer);
 	SDL_RenderCopy(renderer, texture, NULL, NULL);
 	SDL_RenderPresent(renderer);
+	++counts->presents;
+	return(full);
+}
+
+/* Render thread routines */
+int
+FrameBuf:: StartRenderThread(void)
+{
+	int i, size;
+
+	if ( ! texture ) {
+		SetError("Couldn't create render thread: no texture");
+		return(-1);
+	}
+	size = screenfg->h*screenfg->pitch;
+	for ( i = 0; i < RENDER_SLOTS; ++i ) {
+		render_slots[i].pixels = new Uint8[size];
+		render_slots[i].tiles.Init(screenfg->w, screenfg->h);
+		render_slots[i].full_update = 1;
+		render_slots[i].sequence = 0;
+	}
+	frametiles.Init(screenfg->w, screenfg->h);
+	carrytiles.Init(screenfg->w, screenfg->h);
+	carry_full = 1;
+	render_back = 0;
+	render_front = 1;
+	SDL_AtomicSet(&render_latest, 2);
+	SDL_AtomicSet(&render_quit, 0);
+	render_sequence = 0;
+
+	/* The frames are converted to the size of the texture */
+	render_pitch = screenfg->w*scale*4;
+	render_pixels = new Uint8[screenfg->h*scale*render_pitch];
+	render_tiles.Init(screenfg->w, screenfg->h);
+	render_rects = new SDL_Rect[render_tiles.MaxRects()];
+	render_converted = 0;
+	render_presented = 0;
+
+	/* The presents are paced to the display's refresh rate */
+	render_refresh = SDL_GetPerformanceFrequency()/RefreshRate();
+	render_due = 0;
+
+	render_ready = SDL_CreateSemaphore(0);
+	render_lock = SDL_CreateMutex();
+	render_done = SDL_CreateCond();
+	if ( !render_ready || !render_lock || !render_done ) {
+		SetError("Couldn't create render thread: %s", SDL_GetError());
+		StopRenderThread();
+		return(-1);
+	}
+	render_thread = SDL_CreateThread(RenderThread, "FrameBuf", this);
+	if ( render_thread == NULL ) {
+		SetError("Couldn't create render thread: %s", SDL_GetError());
+		StopRenderThread();
+		return(-1);
+	}
+	full_update = 1;
+	return(0);
+}
+/* If the thread can't be started, the frames are converted by this one,
+   and presented by a renderer that waits for the vertical blank again.
+ */
+int
+FrameBuf:: TryRenderThread(void)
+{
+	if ( StartRenderThread() < 0 ) {
+		fprintf(stderr, "Warning: %s, converting without it\n", Error());
+		options &= ~FRAMEBUF_RENDERTHREAD;
+		return(ResetRenderer());
+	}
+	return(0);
+}
+void
+FrameBuf:: StopRenderThread(void)
+{
+	if ( render_thread ) {
+		/* It may be waiting for its last frame to be uploaded */
+		SDL_LockMutex(render_lock);
+		SDL_AtomicSet(&render_quit, 1);
+		SDL_CondBroadcast(render_done);
+		SDL_UnlockMutex(render_lock);
+		SDL_SemPost(render_ready);
+		SDL_WaitThread(render_thread, NULL);
+		render_thread = NULL;
+
+		/* Keep the counts made by the thread */
+		Stats();
+
+		/* Whatever it converted and wasn't shown is shown next */
+		full_update = 1;
+	}
+	if ( render_ready ) {
+		SDL_DestroySemaphore(render_ready);
+		render_ready = NULL;
+	}
+	if ( render_lock ) {
+		SDL_DestroyMutex(render_lock);
+		render_lock = NULL;
+	}
+	if ( render_done ) {
+		SDL_DestroyCond(render_done);
+		render_done = NULL;
+	}
+	for ( int i = 0; i < RENDER_SLOTS; ++i ) {
+		if ( render_slots[i].pixels ) {
+			delete[] render_slots[i].pixels;
+			render_slots[i].pixels = NULL;
+		}
+	}
+	if ( render_pixels ) {
+		delete[] render_pixels;
+		render_pixels = NULL;
+	}
+	if ( render_rects ) {
+		delete[] render_rects;
+		render_rects = NULL;
+	}
+}
+int
+FrameBuf:: RenderThread(void *data)
+{
+	return(((FrameBuf *)data)->RunRenderThread());
+}
+int
+FrameBuf:: RunRenderThread(void)
+{
+	RenderSlot *slot;
+	SDL_Rect *rects, screen_area, area;
+	FrameBufStats counts;
+	Uint8 *pixels;
+	int i, numrects, full;
+
+	screen_area.x = 0;
+	screen_area.y = 0;
+	screen_area.w = screenfg->w;
+	screen_area.h = screenfg->h;
+
+	rects = new SDL_Rect[render_slots[0].tiles.MaxRects()];
+	while ( SDL_SemWait(render_ready) == 0 ) {
+		if ( SDL_AtomicGet(&render_quit) ) {
+			break;
+		}
+		/* Only this thread clears the flag, so it can't change here */
+		if ( !(SDL_AtomicGet(&render_latest) & RENDER_FRESH) ) {
+			continue;
+		}
+		render_front = (SDL_AtomicSet(&render_latest, render_front) &
+								~RENDER_FRESH);
+		slot = &render_slots[render_front];
+
+		/* The last frame has to be uploaded before it's replaced */
+		SDL_LockMutex(render_lock);
+		while ( render_converted && !SDL_AtomicGet(&render_quit) ) {
+			SDL_CondWait(render_done, render_lock);
+		}
+		SDL_UnlockMutex(render_lock);
+		if ( SDL_AtomicGet(&render_quit) ) {
+			break;
+		}
+
+		memset(&counts, 0, sizeof(counts));
+		numrects = slot->tiles.Build(rects);
+		full = (slot->full_update || WholeScreen(rects, numrects));
+		if ( full ) {
+			ConvertArea(&screen_area, slot->pixels, screenfg->pitch,
+				slot->colormap, render_pixels, render_pitch);
+			counts.converted +=
+				screen_area.w*screen_area.h*scale*scale;
+			++counts.full_updates;
+		} else {
+			for ( i=0; i<numrects; ++i ) {
+				if ( ! SDL_IntersectRect(&rects[i],
+						&screen_area, &area) ) {
+					continue;
+				}
+				pixels = render_pixels +
+					area.y*scale*render_pitch +
+					area.x*scale*4;
+				ConvertArea(&area, slot->pixels,
+					screenfg->pitch, slot->colormap,
+					pixels, render_pitch);
+				counts.converted +=
+					area.w*area.h*scale*scale;
+			}
+		}
+
+		SDL_LockMutex(render_lock);
+		render_tiles.Clear();
+		render_tiles.Merge(&slot->tiles);
+		render_full = full;
+		render_fade = slot->fade_level;
+		render_frame = slot->sequence;
+		render_finished = slot->finished;
+		render_converted = 1;
+		render_stats.full_updates += counts.full_updates;
+		render_stats.converted += counts.converted;
+		SDL_CondBroadcast(render_done);
+		SDL_UnlockMutex(render_lock);
+	}
+	delete[] rects;
+	return(0);
+}
+void
+FrameBuf:: HandOver(void)
+{
+	RenderSlot *slot;
+	int i, latest, frame_full;
+
+	frametiles.Clear();
+	for ( i=0; i<updatelen; ++i ) {
+		frametiles.Add(&updatelist[i]);
+	}
+	frame_full = (full_update || !(options & FRAMEBUF_DIRTYUPDATE));
+	full_update = 0;
+
+	/* Copy the frame, along with everything not shown yet */
+	slot = &render_slots[render_back];
+	memcpy(slot->pixels, screenfg->pixels, screenfg->h*screenfg->pitch);
+	memcpy(slot->colormap, colormap, sizeof(slot->colormap));
+	slot->fade_level = fade_level;
+	slot->tiles.Clear();
+	slot->tiles.Merge(&carrytiles);
+	slot->tiles.Merge(&frametiles);
+	slot->full_update = (carry_full || frame_full);
+	slot->sequence = ++render_sequence;
+	slot->finished = SDL_GetPerformanceCounter();
+
+	latest = SDL_AtomicSet(&render_latest, render_back|RENDER_FRESH);
+	render_back = (latest & ~RENDER_FRESH);
+	SDL_SemPost(render_ready);
+
+	/* If the last frame wasn't taken, its areas still need to be shown */
+	if ( latest & RENDER_FRESH ) {
+		carrytiles.Merge(&frametiles);
+		carry_full = (carry_full || frame_full);
+		++stats.dropped_frames;
+	} else {
+		carrytiles.Clear();
+		carrytiles.Merge(&frametiles);
+		carry_full = frame_full;
+	}
+}
+/* Upload and present what the render thread has converted, if anything,
+   or if wait is set, keep going until the last frame handed over is shown.
+   The renderer doesn't wait for the vertical blank, so unless told to
+   wait, a frame converted within a refresh of the last present is left
+   for later, and the frames handed over meanwhile are dropped.
+ */
+void
+FrameBuf:: PresentConverted(int wait)
+{
+	SDL_Rect screen_area, area, texture_area;
+	Uint8 *pixels;
+	Uint32 frame;
+	Uint64 finished, now;
+	Sint64 behind;
+	int i, row, numrects, full, fade;
+	Uint8 level;
+
+	if ( ! render_thread ) {
+		return;
+	}
+	if ( !wait && (SDL_GetPerformanceCounter() < render_due) ) {
+		return;
+	}
+	screen_area.x = 0;
+	screen_area.y = 0;
+	screen_area.w = screenfg->w;
+	screen_area.h = screenfg->h;
+
+	do {
+		SDL_LockMutex(render_lock);
+		while ( wait && !render_converted &&
+			(Sint32)(render_presented - render_sequence) < 0 ) {
+			SDL_CondWait(render_done, render_lock);
+		}
+		if ( ! render_converted ) {
+			SDL_UnlockMutex(render_lock);
+			return;
+		}
+		numrects = render_tiles.Build(render_rects);
+		full = render_full;
+		fade = render_fade;
+		frame = render_frame;
+		finished = render_finished;
+		SDL_UnlockMutex(render_lock);
+
+		/* The render thread leaves render_pixels alone until it's
+		   told they're uploaded, so they're copied without the lock.
+		 */
+		if ( full ) {
+			numrects = 1;
+			render_rects[0] = screen_area;
+		}
+		for ( i=0; i<numrects; ++i ) {
+			if ( ! SDL_IntersectRect(&render_rects[i],
+						&screen_area, &area) ) {
+				continue;
+			}
+			texture_area.x = area.x*scale;
+			texture_area.y = area.y*scale;
+			texture_area.w = area.w*scale;
+			texture_area.h = area.h*scale;
+			if ( SDL_LockTexture(texture, &texture_area,
+				&staging->pixels, &staging->pitch) < 0 ) {
+				full_update = 1;
+				continue;
+			}
+			pixels = render_pixels +
+				texture_area.y*render_pitch + texture_area.x*4;
+			for ( row=0; row<texture_area.h; ++row ) {
+				memcpy((Uint8 *)staging->pixels +
+						row*staging->pitch,
+					pixels, texture_area.w*4);
+				pixels += render_pitch;
+			}
+			SDL_UnlockTexture(texture);
+		}
+		if ( options & FRAMEBUF_NATIVE32 ) {
+			level = (Uint8)((fade * 255) / FRAMEBUF_FADE_STEPS);
+			SDL_SetTextureColorMod(texture, level, level, level);
+		}
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+		++stats.presents;
+		now = SDL_GetPerformanceCounter();
+		if ( (now - finished) > 2*render_refresh ) {
+			++stats.late_frames;
+		}
+
+		/* Keep to the refresh rate, unless the presents fell off it */
+		behind = (Sint64)(now - render_due);
+		if ( (behind > (Sint64)render_refresh) ||
+		     (behind < -(Sint64)render_refresh) ) {
+			render_due = now;
+		}
+		render_due += render_refresh;
+
+		SDL_LockMutex(render_lock);
+		render_converted = 0;
+		render_presented = frame;
+		SDL_CondBroadcast(render_done);
+		SDL_UnlockMutex(render_lock);
+	} while ( wait && (Sint32)(frame - render_sequence) < 0 );
+}
+const FrameBufStats *
+FrameBuf:: Stats(void)
+{
+	/* Collect the counts made by the render thread */
+	if ( render_lock ) {
+		SDL_LockMutex(render_lock);
+		stats.full_updates += render_stats.full_updates;
+		stats.converted += render_stats.converted;
+		memset(&render_stats, 0, sizeof(render_stats));
+		SDL_UnlockMutex(render_lock);
+	}
+	return(&stats);
+}
+void
+FrameBuf:: ResetStats(void)
+{
+	if ( render_lock ) {
+		SDL_LockMutex(render_lock);
+	}
+	memset(&render_stats, 0, sizeof(render_stats));
+	if ( render_lock ) {
+		SDL_UnlockMutex(render_lock);
+	}
+	memset(&stats, 0, sizeof(stats));
 }
 
 /* Drawing routines */
@@ -332,21 +1143,7 @@ FrameBuf:: Clear(Sint16 x, Sint16 y, Uint16 w, Uint16 h, clipval do_clip)
 	if ( screen == screenfg ) {
 		QueueBlit(x, y, screenbg, x, y, w, h, do_clip);
 	} else {
-		Uint8 screen_bpp;
-		Uint8 *screen_loc;
-
-		screen_bpp = screen->format->BytesPerPixel;
-		screen_loc = screen_mem + y*screen->pitch + x*screen_bpp;
-		w *= screen_bpp;
-		while ( h-- ) {
-			/* Note that BGcolor is a 32 bit quantity while memset()
-			   fills with an 8-bit quantity.  This only matters if
-			   the background is a different color than black on a
-			   HiColor or TrueColor display.
-			 */
-			memset(screen_loc, BGcolor, w);
-			screen_loc += screen->pitch;
-		}
+		DRAW_BPP(screen, DrawFill, (screen, x, y, w, h, BGcolor));
 	}
 }
 void
@@ -356,152 +1153,58 @@ FrameBuf:: DrawPoint(Sint16 x, Sint16 y, Uint32 color)
 
 	/* Adjust the bounds */
 	if ( x < 0 ) return;
-	if ( x > screen->w ) return;
+	if ( x >= screen->w ) return;
 	if ( y < 0 ) return;
-	if ( y > screen->h ) return;
+	if ( y >= screen->h ) return;
 
 	PerformBlits();
-	PutPixel(screen_mem+y*screen->pitch+x*screen->format->BytesPerPixel,
-								screen, color);
+	DRAW_BPP(screen, DrawPixel, (screen, x, y, color));
 	dirty.x = x;
 	dirty.y = y;
 	dirty.w = 1;
 	dirty.h = 1;
 	AddDirtyRect(&dirty);
 }
-/* Simple, slow, line drawing algorithm.  Improvement, anyone? :-) */
 void
 FrameBuf:: DrawLine(Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uint32 color)
 {
 	SDL_Rect dirty;
-	Sint16   x , y;
-	Sint16   lo, hi;
-	double slope, b;
-	Uint8  screen_bpp;
-	Uint8 *screen_loc;
 
 	/* Adjust the bounds */
-	ADJUSTX(x1); ADJUSTY(y1);
-	ADJUSTX(x2); ADJUSTY(y2);
+	CLAMPX(x1); CLAMPY(y1);
+	CLAMPX(x2); CLAMPY(y2);
 	
 	PerformBlits();
-	screen_bpp = screen->format->BytesPerPixel;
+	dirty.x = MIN(x1, x2);
+	dirty.y = MIN(y1, y2);
+	dirty.w = (Uint16)(MAX(x1, x2)-dirty.x+1);
+	dirty.h = (Uint16)(MAX(y1, y2)-dirty.y+1);
 	if ( y1 == y2 )  {  /* Horizontal line */
-		if ( x1 < x2 ) {
-			lo = x1;
-			hi = x2;
-		} else {
-			lo = x2;
-			hi = x1;
-		}
-		screen_loc = screen_mem + y1*screen->pitch + lo*screen_bpp;
-		for ( x=lo; x<=hi; ++x ) {
-			PutPixel(screen_loc, screen, color);
-			screen_loc += screen_bpp;
-		}
-		dirty.x = lo;
-		dirty.y = y1;
-		dirty.w = (Uint16)(hi-lo+1);
-		dirty.h = 1;
-		AddDirtyRect(&dirty);
+		DRAW_BPP(screen, DrawHLine,
+			(screen, dirty.x, y1, dirty.w, color));
 	} else if ( x1 == x2 ) {  /* Vertical line */
-		if ( y1 < y2 ) {
-			lo = y1;
-			hi = y2;
-		} else {
-			lo = y2;
-			hi = y1;
-		}
-		screen_loc = screen_mem + lo*screen->pitch + x1*screen_bpp;
-		for ( y=lo; y<=hi; ++y ) {
-			PutPixel(screen_loc, screen, color);
-			screen_loc += screen->pitch;
-		}
-		dirty.x = x1;
-		dirty.y = lo;
-		dirty.w = 1;
-		dirty.h = (Uint16)(hi-lo+1);
-		AddDirtyRect(&dirty);
+		DRAW_BPP(screen, DrawVLine,
+			(screen, x1, dirty.y, dirty.h, color));
 	} else {
-		/* Equation:  y = mx + b */
-		slope = ((double)((int)(y2 - y1)) / 
-					(double)((int)(x2 - x1)));
-		b = (double)(y1 - slope*(double)x1);
-		if ( ((slope < 0) ? slope > -1 : slope < 1) ) {
-			if ( x1 < x2 ) {
-				lo = x1;
-				hi = x2;
-			} else {
-				lo = x2;
-				hi = x1;
-			}
-			for ( x=lo; x<=hi; ++x ) {
-				y = (int)((slope*(double)x) + b);
-				screen_loc = screen_mem + 
-						y*screen->pitch + x*screen_bpp;
-				PutPixel(screen_loc, screen, color);
-			}
-		} else {
-			if ( y1 < y2 ) {
-				lo = y1;
-				hi = y2;
-			} else {
-				lo = y2;
-				hi = y1;
-			}
-			for ( y=lo; y<=hi; ++y ) {
-				x = (int)(((double)y - b)/slope);
-				screen_loc = screen_mem + 
-						y*screen->pitch + x*screen_bpp;
-				PutPixel(screen_loc, screen, color);
-			}
-		}
-		dirty.x = MIN(x1, x2);
-		dirty.y = MIN(y1, y2);
-		dirty.w = (Uint16)(MAX(x1, x2)-dirty.x+1);
-		dirty.h = (Uint16)(MAX(y1, y2)-dirty.y+1);
-		AddDirtyRect(&dirty);
+		DRAW_BPP(screen, DrawSlope, (screen, x1, y1, x2, y2, color));
 	}
+	AddDirtyRect(&dirty);
 }
 void
 FrameBuf:: DrawRect(Sint16 x, Sint16 y, Uint16 w, Uint16 h, Uint32 color)
 {
 	SDL_Rect dirty;
-	int i;
-	Uint8  screen_bpp;
-	Uint8 *screen_loc;
 
 	/* Adjust the bounds */
 	ADJUSTX(x); ADJUSTY(y);
 	if ( (x+w) > screen->w ) w = (Uint16)(screen->w-x);
 	if ( (y+h) > screen->h ) h = (Uint16)(screen->h-y);
-
-	PerformBlits();
-	screen_bpp = screen->format->BytesPerPixel;
-
-	/* Horizontal lines */
-	screen_loc = screen_mem + y*screen->pitch + x*screen_bpp;
-	for ( i=0; i<w; ++i ) {
-		PutPixel(screen_loc, screen, color);
-		screen_loc += screen_bpp;
-	}
-	screen_loc = screen_mem + (y+h-1)*screen->pitch + x*screen_bpp;
-	for ( i=0; i<w; ++i ) {
-		PutPixel(screen_loc, screen, color);
-		screen_loc += screen_bpp;
+	if ( !w || !h ) {
+		return;
 	}
 
-	/* Vertical lines */
-	screen_loc = screen_mem + y*screen->pitch + x*screen_bpp;
-	for ( i=0; i<h; ++i ) {
-		PutPixel(screen_loc, screen, color);
-		screen_loc += screen->pitch;
-	}
-	screen_loc = screen_mem + y*screen->pitch + (x+w-1)*screen_bpp;
-	for ( i=0; i<h; ++i ) {
-		PutPixel(screen_loc, screen, color);
-		screen_loc += screen->pitch;
-	}
+	PerformBlits();
+	DRAW_BPP(screen, DrawFrame, (screen, x, y, w, h, color));
 
 	/* Update rectangle */
 	dirty.x = x;
@@ -514,9 +1217,6 @@ void
 FrameBuf:: FillRect(Sint16 x, Sint16 y, Uint16 w, Uint16 h, Uint32 color)
 {
 	SDL_Rect dirty;
-	Uint16 i, skip;
-	Uint8 screen_bpp;
-	Uint8 *screen_loc;
 
 	/* Adjust the bounds */
 	ADJUSTX(x); ADJUSTY(y);
@@ -529,17 +1229,7 @@ FrameBuf:: FillRect(Sint16 x, Sint16 y, Uint16 w, Uint16 h, Uint32 color)
 	dirty.w = w;
 	dirty.h = h;
 
-	/* Semi-efficient, for now. :) */
-	screen_bpp = screen->format->BytesPerPixel;
-	screen_loc = screen_mem + y*screen->pitch + x*screen_bpp;
-	skip = screen->pitch - (w*screen_bpp);
-	while ( h-- ) {
-		for ( i=w; i!=0; --i ) {
-			PutPixel(screen_loc, screen, color);
-			screen_loc += screen_bpp;
-		}
-		screen_loc += skip;
-	}
+	DRAW_BPP(screen, DrawFill, (screen, x, y, w, h, color));
 	AddDirtyRect(&dirty);
 }
 
@@ -569,32 +1259,70 @@ static inline void memswap(Uint8 *dst, Uint8 *src, Uint8 len)
 void
 FrameBuf:: Fade(void)
 {
-	const int max = 32;
-	Uint8 ramp[256];
-	int i, j;
-
-	if ( palette ) {
-		for ( j = 1; j <= max; j++ ) {
-			int v = faded ? j : max - j;
+	/* Without a display there's nothing to watch */
+	if ( options & FRAMEBUF_HEADLESS ) {
+		StartFade(0);
+		return;
+	}
 
-			for ( i = 0; i < 256; ++i ) {
-				ramp[i] = (Uint8)(i * v / max);
-			}
-			for ( i = 0; i < 256; ++i ) {
-				Uint8 r = ramp[palette->colors[i].r];
-				Uint8 g = ramp[palette->colors[i].g];
-				Uint8 b = ramp[palette->colors[i].b];
-				colormap[i] = SDL_MapRGB(staging->format, r, g, b);
-			}
+	StartFade();
+	while ( fade_duration ) {
+		AdvanceFade();
+		if ( full_update ) {
+			/* Only the colors change */
+			updatelen = 0;
 			UpdateScreen();
 
-			// Prevent the "busy" cursor on macOS
-			SDL_PumpEvents();
+			/* The fade is paced by the display */
+			PresentConverted(1);
+		} else {
+			SDL_Delay(1);
 		}
+
+		// Prevent the "busy" cursor on macOS
+		SDL_PumpEvents();
 	}
+}
+void
+FrameBuf:: StartFade(Uint32 duration)
+{
+	int step;
 
+	/* Turn around from the current level if a fade is under way */
 	faded = !faded;
-} 
+	step = faded ? (FRAMEBUF_FADE_STEPS - fade_level) : fade_level;
+	fade_duration = duration;
+	fade_start = SDL_GetTicks() -
+		(step * duration + FRAMEBUF_FADE_STEPS-1) / FRAMEBUF_FADE_STEPS;
+	if ( ! fade_duration ) {
+		fade_level = faded ? 0 : FRAMEBUF_FADE_STEPS;
+		colormap = fademaps[fade_level];
+		full_update = 1;
+	}
+}
+void
+FrameBuf:: AdvanceFade(void)
+{
+	Uint32 elapsed;
+	int step, level;
+
+	if ( ! fade_duration ) {
+		return;
+	}
+	elapsed = SDL_GetTicks() - fade_start;
+	if ( elapsed >= fade_duration ) {
+		step = FRAMEBUF_FADE_STEPS;
+		fade_duration = 0;
+	} else {
+		step = (int)((elapsed * FRAMEBUF_FADE_STEPS) / fade_duration);
+	}
+	level = faded ? (FRAMEBUF_FADE_STEPS - step) : step;
+	if ( level != fade_level ) {
+		fade_level = level;
+		colormap = fademaps[fade_level];
+		full_update = 1;
+	}
+}
 
 SDL_Surface *
 FrameBuf:: GrabArea(Uint16 x, Uint16 y, Uint16 w, Uint16 h)
@@ -615,22 +1343,17 @@ FrameBuf:: GrabArea(Uint16 x, Uint16 y, Uint16 w, Uint16 h)
 		h -= (screen->h-(y+h));
 	}
 
-	/* Allocate an area of the same pixel format */
-	area = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h,
-				screen->format->BitsPerPixel, 
-					screen->format->Rmask,
-					screen->format->Gmask,
-					screen->format->Bmask, 0);
+	/* Get an area of the same pixel size, to copy the pixels as they are */
+	area = areas->Get(w, h, screen->format->BitsPerPixel);
 	if ( area ) {
 		Uint8 *area_mem;
 		Uint8 *scrn_mem;
 		int cursor_shown;
 
 		if ( area->format->palette ) {
-			memcpy(area->format->palette->colors,
-				screen->format->palette->colors,
-				screen->format->palette->ncolors
-						*sizeof(SDL_Color));
+			SDL_SetPaletteColors(area->format->palette,
+				screen->format->palette->colors, 0,
+				screen->format->palette->ncolors);
 		}
 		cursor_shown = SDL_ShowCursor(0);
 		Lock();
@@ -645,40 +1368,48 @@ FrameBuf:: GrabArea(Uint16 x, Uint16 y, Uint16 w, Uint16 h)
 		}
 		Unlock();
 		SDL_ShowCursor(cursor_shown);
-	}
 
-	/* Add the area to the list of images */
-	itail->next = new image_list;
-	itail = itail->next;
-	itail->image = area;
-	itail->next = NULL;
+		/* A reused area has the spans for its size already */
+		if ( area->userdata == NULL ) {
+			BuildSpans(area, 0, 0);
+		}
+	} else {
+		SetError("Couldn't grab area: %s", SDL_GetError());
+	}
 	return(area);
 }
 
+/* Get a suitable new filename */
+static void NewFileName(const char *prefix, const char *ext,
+						char *file, int maxlen)
+{
+	int which, found;
+	FILE *fp;
+
+	found = 0;
+	for ( which=0; !found; ++which ) {
+		SDL_snprintf(file, maxlen, "%s%d.%s", prefix, which, ext);
+		if ( ((fp=fopen(file, "r")) == NULL) &&
+		     ((fp=fopen(file, "w")) != NULL) ) {
+			found = 1;
+		}
+		if ( fp != NULL ) {
+			fclose(fp);
+		}
+	}
+}
+
 int
 FrameBuf:: ScreenDump(const char *prefix, Uint16 x, Uint16 y, Uint16 w, Uint16 h)
 {
 	SDL_Surface *dump;
 	int retval;
 
-	/* Get a suitable new filename */
 	dump = GrabArea(x, y, w, h);
 	if ( dump ) {
-		int which, found;
 		char file[1024];
-		FILE *fp;
-
-		found = 0;
-		for ( which=0; !found; ++which ) {
-			SDL_snprintf(file, sizeof(file), "%s%d.bmp", prefix, which);
-			if ( ((fp=fopen(file, "r")) == NULL) &&
-			     ((fp=fopen(file, "w")) != NULL) ) {
-				found = 1;
-			}
-			if ( fp != NULL ) {
-				fclose(fp);
-			}
-		}
+
+		NewFileName(prefix, "bmp", file, sizeof(file));
 		retval = SDL_SaveBMP(dump, file);
 		if ( retval < 0 ) {
 			SetError("%s", SDL_GetError());
@@ -690,92 +1421,225 @@ FrameBuf:: ScreenDump(const char *prefix, Uint16 x, Uint16 y, Uint16 w, Uint16 h
 	return(retval);
 }
 
+int
+FrameBuf:: StartCapture(const char *prefix)
+{
+	char file[1024];
+
+	StopCapture();
+	if ( screenfg == NULL ) {
+		SetError("The screen isn't set up yet");
+		return(-1);
+	}
+	if ( screenfg->format->BytesPerPixel != 1 ) {
+		SetError("Only 8-bit frames can be captured");
+		return(-1);
+	}
+	NewFileName(prefix, "mcap", file, sizeof(file));
+	capture = new FrameCapture;
+	if ( capture->Open(file, screenfg->w, screenfg->h) < 0 ) {
+		SetError("%s", capture->Error());
+		delete capture;
+		capture = NULL;
+		return(-1);
+	}
+	return(0);
+}
+int
+FrameBuf:: StopCapture(void)
+{
+	int status;
+
+	status = 0;
+	if ( capture ) {
+		if ( capture->Close() < 0 ) {
+			SetError("%s", capture->Error());
+			status = -1;
+		}
+		delete capture;
+		capture = NULL;
+	}
+	return(status);
+}
+
 SDL_Surface *
 FrameBuf:: LoadImage(Uint16 w, Uint16 h, Uint8 *pixels, Uint8 *mask)
 {
 	SDL_Surface *artwork;
-	int i, j, pad;
-	Uint8 *art_mem, *pix_mem;
-
-	/* Assume 8-bit artwork using the current palette */
-	artwork = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h,
-				screenfg->format->BitsPerPixel, 
-					screenfg->format->Rmask,
-					screenfg->format->Gmask,
-					screenfg->format->Bmask, 0);
+	int i, pad;
+	Uint8 *pix_mem;
+
+	artwork = CreateImage(w, h);
 	if ( artwork == NULL ) {
-		SetError("Couldn't create artwork: %s", SDL_GetError());
 		return(NULL);
 	}
 
-	/* Set the palette and copy pixels, checking for colorkey */
-	if ( artwork->format->palette != NULL ) {
-		memcpy(artwork->format->palette->colors,
-		       screenfg->format->palette->colors,
-		       screenfg->format->palette->ncolors*sizeof(SDL_Color));
-	}
+	/* Copy pixels, checking for colorkey */
 	pad  = ((w%4) ? (4-(w%4)) : 0);
 	if ( mask ) {
 		int used[256];
-		Uint8 colorkey, m;
-
-		/* Look for an unused palette entry */
-		memset(used, 0, 256);
-		pix_mem = pixels;
-		for ( i=(w*h); i!=0; --i ) {
-			++used[*pix_mem];
-			++pix_mem;
-		}
-		for ( i=0; used[i] && i<256; ++i ) {
-			/* Keep looking */;
+		Uint32 colorkey;
+
+		if ( artwork->format->palette ) {
+			/* Look for an unused palette entry */
+			memset(used, 0, sizeof(used));
+			pix_mem = pixels;
+			for ( i=(w*h); i!=0; --i ) {
+				++used[*pix_mem];
+				++pix_mem;
+			}
+			for ( i=0; i<256 && used[i]; ++i ) {
+				/* Keep looking */;
+			}
+			colorkey = (Uint8)i;
+		} else {
+			/* Mapped colors are opaque, so clear black is unused */
+			colorkey = 0;
 		}
-		colorkey = (Uint8)i;
 	
 		/* Copy over the pixels */
-		pix_mem = pixels;
-		for ( i=0; i<h; ++i ) {
-			art_mem = (Uint8 *)artwork->pixels + i*artwork->pitch;
-			for ( j=0; j<w; ++j ) {
-				if ( (j%8) == 0 ) {
-					m = *mask++;
-				}
-				if ( m & 0x80 ) {
-					PutPixel(art_mem, screenfg, *pix_mem);
-				} else {
-					PutPixel(art_mem, screenfg, colorkey);
-				}
-				m <<= 1;
-				art_mem += artwork->format->BytesPerPixel;
-				pix_mem += 1;
-			}
-			pix_mem += pad;
-		}
-		SDL_SetColorKey(artwork, SDL_RLEACCEL, colorkey);
+		DRAW_BPP(artwork, DrawArtwork, (artwork, 0, 0, w, h, pixels,
+				mask, ArtworkMap(artwork), colorkey, pad));
+
+		/* We do our own run-length blitting, see BlitSpans() */
+		SDL_SetColorKey(artwork, SDL_TRUE, colorkey);
+		BuildSpans(artwork, 1, colorkey);
 	} else {
 		/* Copy over the pixels */
-		pix_mem = pixels;
-		for ( i=0; i<h; ++i ) {
-			art_mem = (Uint8 *)artwork->pixels + i*artwork->pitch;
-			for ( j=0; j<w; ++j ) {
-				PutPixel(art_mem, screenfg, *pix_mem);
-				art_mem += artwork->format->BytesPerPixel;
-				pix_mem += 1;
-			}
-			pix_mem += pad;
-		}
+		DRAW_BPP(artwork, DrawArtwork, (artwork, 0, 0, w, h, pixels,
+				NULL, ArtworkMap(artwork), 0, pad));
+		BuildSpans(artwork, 0, 0);
+	}
+	AddImage(artwork);
+	return(artwork);
+}
+SDL_Surface *
+FrameBuf:: CreateImage(Uint16 w, Uint16 h)
+{
+	SDL_Surface *artwork;
+
+	/* Artwork is in the screen format, using the current palette */
+	artwork = SDL_CreateRGBSurfaceWithFormat(SDL_SWSURFACE, w, h,
+					screenfg->format->BitsPerPixel,
+					screenfg->format->format);
+	if ( artwork == NULL ) {
+		SetError("Couldn't create artwork: %s", SDL_GetError());
+		return(NULL);
 	}
+	SDL_SetSurfaceBlendMode(artwork, SDL_BLENDMODE_NONE);
+
+	/* Set the palette */
+	if ( artwork->format->palette != NULL ) {
+		memcpy(artwork->format->palette->colors,
+		       screenfg->format->palette->colors,
+		       screenfg->format->palette->ncolors*sizeof(SDL_Color));
+	}
+	return(artwork);
+}
+void
+FrameBuf:: AddImage(SDL_Surface *image)
+{
 	/* Add the image to the list of images */
 	itail->next = new image_list;
 	itail = itail->next;
-	itail->image = artwork;
+	itail->image = image;
 	itail->next = NULL;
-	return(artwork);
+}
+
+int
+FrameBuf:: AtlasImage(Uint16 w, Uint16 h, Uint8 *pixels, Uint8 *mask,
+							AtlasFrame *frame)
+{
+	int i, j, pad;
+	Uint8 *opaque, m;
+
+	/* Images too big for a page get a surface of their own */
+	if ( (w > ATLAS_PAGE_WIDTH) || (h > ATLAS_PAGE_HEIGHT) ) {
+		frame->page = LoadImage(w, h, pixels, mask);
+		if ( frame->page == NULL ) {
+			return(-1);
+		}
+		frame->area.x = 0;
+		frame->area.y = 0;
+		frame->area.w = w;
+		frame->area.h = h;
+		return(0);
+	}
+
+	/* Start a new shelf if the image doesn't fit next to the last one */
+	if ( ((atlas_x+w) > ATLAS_PAGE_WIDTH) ||
+	     ((atlas_x > 0) && (h > atlas_shelf)) ) {
+		atlas_y += atlas_shelf;
+		atlas_x = 0;
+		atlas_shelf = 0;
+	}
+	if ( atlas && ((atlas_y+h) > ATLAS_PAGE_HEIGHT) ) {
+		FinishAtlas();
+	}
+
+	/* Start a new page, if needed */
+	if ( atlas == NULL ) {
+		atlas = CreateImage(ATLAS_PAGE_WIDTH, ATLAS_PAGE_HEIGHT);
+		if ( atlas == NULL ) {
+			return(-1);
+		}
+		AddImage(atlas);
+		if ( atlas_opaque == NULL ) {
+			atlas_opaque = new Uint8[ATLAS_PAGE_WIDTH*ATLAS_PAGE_HEIGHT];
+		}
+		memset(atlas_opaque, 0, ATLAS_PAGE_WIDTH*ATLAS_PAGE_HEIGHT);
+		atlas_x = 0;
+		atlas_y = 0;
+		atlas_shelf = 0;
+	}
+	frame->page = atlas;
+	frame->area.x = atlas_x;
+	frame->area.y = atlas_y;
+	frame->area.w = w;
+	frame->area.h = h;
+	atlas_x += w;
+	if ( h > atlas_shelf ) {
+		atlas_shelf = h;
+	}
+
+	/* Copy the pixels, and remember which ones are opaque */
+	pad  = ((w%4) ? (4-(w%4)) : 0);
+	DRAW_BPP(atlas, DrawArtwork, (atlas, frame->area.x, frame->area.y,
+				w, h, pixels, mask, ArtworkMap(atlas), 0, pad));
+	m = 0xFF;
+	for ( i=0; i<h; ++i ) {
+		opaque = &atlas_opaque[(frame->area.y+i)*ATLAS_PAGE_WIDTH +
+							frame->area.x];
+		for ( j=0; j<w; ++j ) {
+			if ( mask && ((j%8) == 0) ) {
+				m = *mask++;
+			}
+			opaque[j] = (m & 0x80);
+			if ( mask ) {
+				m <<= 1;
+			}
+		}
+	}
+	return(0);
+}
+void
+FrameBuf:: FinishAtlas(void)
+{
+	if ( atlas ) {
+		BuildSpans(atlas, 0, 0, atlas_opaque);
+		atlas = NULL;
+	}
 }
 void
 FrameBuf:: FreeImage(SDL_Surface *image)
 {
 	image_list *ielem, *iold;
 
+	/* Grabbed areas go back to their pool */
+	if ( areas->Put(image) ) {
+		return;
+	}
+
 	/* Remove the image from the list of images */
 	for ( ielem=&images; ielem->next; ) {
 		iold = ielem->next;
@@ -784,7 +1648,7 @@ FrameBuf:: FreeImage(SDL_Surface *image)
 				itail = ielem;
 			}
 			ielem->next = iold->next;
-			SDL_FreeSurface(iold->image);
+			ReleaseImage(iold->image);
 			delete iold;
 			return;
 		} else {
@@ -794,8 +1658,130 @@ FrameBuf:: FreeImage(SDL_Surface *image)
 	fprintf(stderr, "Warning: image to be freed not in list\n");
 }
 
+/* Find the runs of opaque pixels on each row of an 8 or 32-bit image */
 void
-FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
+FrameBuf:: BuildSpans(SDL_Surface *image, int use_key, Uint32 colorkey,
+							const Uint8 *opaque)
+{
+	ImageSpans *spans;
+	Uint8 *block, *row;
+	const Uint8 *mask;
+	int numspans, x, y, start, bpp;
+
+	bpp = image->format->BytesPerPixel;
+	if ( (bpp != 1) && (bpp != 4) ) {
+		return;
+	}
+
+	/* Pixels are clear where the opaque map, if any, or colorkey says */
+#define PIXEL(X)	((bpp == 1) ? row[X] : ((Uint32 *)row)[X])
+#define CLEAR_PIXEL(X)	(mask ? !mask[X] : (use_key && (PIXEL(X) == colorkey)))
+
+	/* Count the spans, so they can go in a single allocation */
+	numspans = 0;
+	for ( y=0; y<image->h; ++y ) {
+		row = (Uint8 *)image->pixels + y*image->pitch;
+		mask = opaque ? &opaque[y*image->w] : NULL;
+		for ( x=0; x<image->w; ) {
+			if ( CLEAR_PIXEL(x) ) {
+				++x;
+				continue;
+			}
+			while ( (x < image->w) && !CLEAR_PIXEL(x) ) {
+				++x;
+			}
+			++numspans;
+		}
+	}
+
+	block = new Uint8[sizeof(*spans) +
+			(image->h+1)*sizeof(*spans->rows) +
+				numspans*sizeof(*spans->spans)];
+	spans = (ImageSpans *)block;
+	spans->rows = (int *)(block + sizeof(*spans));
+	spans->spans = (ImageSpan *)(spans->rows + image->h+1);
+
+	numspans = 0;
+	for ( y=0; y<image->h; ++y ) {
+		spans->rows[y] = numspans;
+		row = (Uint8 *)image->pixels + y*image->pitch;
+		mask = opaque ? &opaque[y*image->w] : NULL;
+		for ( x=0; x<image->w; ) {
+			if ( CLEAR_PIXEL(x) ) {
+				++x;
+				continue;
+			}
+			start = x;
+			while ( (x < image->w) && !CLEAR_PIXEL(x) ) {
+				++x;
+			}
+			spans->spans[numspans].x = start;
+			spans->spans[numspans].w = x-start;
+			++numspans;
+		}
+	}
+	spans->rows[image->h] = numspans;
+	image->userdata = spans;
+#undef CLEAR_PIXEL
+#undef PIXEL
+}
+
+/* Copy the opaque runs of an image to the screen, in the same format.
+   The rectangles have already been clipped by QueueBlit().
+ */
+void
+FrameBuf:: BlitSpans(SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect)
+{
+	ImageSpans *spans;
+	ImageSpan *span, *end;
+	Uint8 *srcrow, *dstrow;
+	int x1, x2, a, b, row, bpp;
+
+	spans = (ImageSpans *)src->userdata;
+	bpp = screen->format->BytesPerPixel;
+	x1 = srcrect->x;
+	x2 = srcrect->x+srcrect->w;
+	srcrow = (Uint8 *)src->pixels + srcrect->y*src->pitch;
+	dstrow = (Uint8 *)screen->pixels +
+			dstrect->y*screen->pitch + dstrect->x*bpp;
+	for ( row=srcrect->y; row<(srcrect->y+srcrect->h); ++row ) {
+		span = &spans->spans[spans->rows[row]];
+		end = &spans->spans[spans->rows[row+1]];
+		for ( ; span < end; ++span ) {
+			a = span->x;
+			b = span->x+span->w;
+			if ( a < x1 ) {
+				a = x1;
+			}
+			if ( b > x2 ) {
+				b = x2;
+			}
+			if ( a < b ) {
+				memcpy(dstrow+(a-x1)*bpp, srcrow+a*bpp,
+								(b-a)*bpp);
+			}
+		}
+		srcrow += src->pitch;
+		dstrow += screen->pitch;
+	}
+}
+
+/* Drop a reference to an image, freeing its spans with the last one */
+void
+FrameBuf:: ReleaseImage(SDL_Surface *image)
+{
+	if ( (image->refcount == 1) && image->userdata ) {
+		delete[] (Uint8 *)image->userdata;
+		image->userdata = NULL;
+	}
+	SDL_FreeSurface(image);
+}
+
+/* Fill in a queued blit, clipped if requested, returning 0 if there's
+   nothing left of it.
+ */
+int
+FrameBuf:: ClipQueued(BlitQ *blit, int dstx, int dsty, SDL_Surface *src,
 			int srcx, int srcy, int w, int h, clipval do_clip)
 {
 	int diff;
@@ -806,7 +1792,7 @@ FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
 		if ( diff > 0 ) {
 			w -= diff;
 			if ( w <= 0 )
-				return;
+				return(0);
 			srcx += diff;
 			dstx = clip.x;
 		}
@@ -814,7 +1800,7 @@ FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
 		if ( diff > 0 ) {
 			h -= diff;
 			if ( h <= 0 )
-				return;
+				return(0);
 			srcy += diff;
 			dsty = clip.y;
 		}
@@ -822,16 +1808,31 @@ FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
 		if ( diff > 0 ) {
 			w -= diff;
 			if ( w <= 0 )
-				return;
+				return(0);
 		}
 		diff = (int)(dsty+h) - (clip.y+clip.h);
 		if ( diff > 0 ) {
 			h -= diff;
 			if ( h <= 0 )
-				return;
+				return(0);
 		}
 	}
+	blit->src = src;
+	blit->srcrect.x = srcx;
+	blit->srcrect.y = srcy;
+	blit->srcrect.w = w;
+	blit->srcrect.h = h;
+	blit->dstrect.x = dstx;
+	blit->dstrect.y = dsty;
+	blit->dstrect.w = w;
+	blit->dstrect.h = h;
+	return(1);
+}
 
+void
+FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
+			int srcx, int srcy, int w, int h, clipval do_clip)
+{
 	/* Lengthen the queue if necessary */
 	if ( blitQlen == blitQmax ) {
 		BlitQ *newq;
@@ -844,73 +1845,127 @@ FrameBuf:: QueueBlit(int dstx, int dsty, SDL_Surface *src,
 	}
 
 	/* Add the blit to the queue */
+	if ( ! ClipQueued(&blitQ[blitQlen], dstx, dsty, src,
+					srcx, srcy, w, h, do_clip) ) {
+		return;
+	}
 	++src->refcount;
-	blitQ[blitQlen].src = src;
-	blitQ[blitQlen].srcrect.x = srcx;
-	blitQ[blitQlen].srcrect.y = srcy;
-	blitQ[blitQlen].srcrect.w = w;
-	blitQ[blitQlen].srcrect.h = h;
-	blitQ[blitQlen].dstrect.x = dstx;
-	blitQ[blitQlen].dstrect.y = dsty;
-	blitQ[blitQlen].dstrect.w = w;
-	blitQ[blitQlen].dstrect.h = h;
 	AddDirtyRect(&blitQ[blitQlen].dstrect);
 	++blitQlen;
 }
 
+void
+FrameBuf:: QueueSprite(int dstx, int dsty, SDL_Surface *src,
+					int srcx, int srcy, int w, int h)
+{
+	/* Lengthen the queue if necessary */
+	if ( spriteQlen == spriteQmax ) {
+		BlitQ *newq;
+
+		spriteQmax += QUEUE_CHUNK;
+		newq = new BlitQ[spriteQmax];
+		memcpy(newq, spriteQ, spriteQlen*sizeof(BlitQ));
+		delete[] spriteQ;
+		spriteQ = newq;
+	}
+
+	/* The area is marked when the sprites are composed */
+	if ( ! ClipQueued(&spriteQ[spriteQlen], dstx, dsty, src,
+					srcx, srcy, w, h, DOCLIP) ) {
+		return;
+	}
+	++src->refcount;
+	++spriteQlen;
+	sprite_frame = 1;
+}
+
+/* Rebuild the tiles under the last and the new sprites: the background is
+   copied to each tile once, then the sprites are drawn over it in the order
+   they were queued.  Every new sprite is inside the tiles, so each is drawn
+   whole and only where sprites overlap is anything drawn twice.
+ */
+void
+FrameBuf:: ComposeSprites(void)
+{
+	SDL_Rect area;
+	BlitQ *sprite;
+	SDL_Surface *src;
+	int i, numrects;
+
+	for ( i=0; i<lastspriteslen; ++i ) {
+		spritetiles.Add(&lastsprites[i]);
+	}
+	for ( i=0; i<spriteQlen; ++i ) {
+		spritetiles.Add(&spriteQ[i].dstrect);
+	}
+	numrects = spritetiles.Build(spriterects);
+	dirtytiles.Merge(&spritetiles);
+	dirty_fg = 1;
+	spritetiles.Clear();
+
+	for ( i=0; i<numrects; ++i ) {
+		/* Whole tiles may reach past the area sprites are drawn in */
+		if ( SDL_IntersectRect(&spriterects[i], &clip, &area) ) {
+			BlitSpans(screenbg, &area, &area);
+		}
+	}
+	for ( i=0; i<spriteQlen; ++i ) {
+		sprite = &spriteQ[i];
+		if ( sprite->src->userdata ) {
+			BlitSpans(sprite->src, &sprite->srcrect,
+						&sprite->dstrect);
+		} else {
+			SDL_LowerBlit(sprite->src, &sprite->srcrect,
+						screen, &sprite->dstrect);
+		}
+	}
+
+	/* The new sprites are the ones to replace next time */
+	if ( spriteQlen > lastspritesmax ) {
+		delete[] lastsprites;
+		lastspritesmax = spriteQmax;
+		lastsprites = new SDL_Rect[lastspritesmax];
+	}
+	for ( i=0; i<spriteQlen; ++i ) {
+		lastsprites[i] = spriteQ[i].dstrect;
+		src = spriteQ[i].src;
+		if ( src->refcount > 1 ) {
+			--src->refcount;
+		} else {
+			ReleaseImage(src);
+		}
+	}
+	lastspriteslen = spriteQlen;
+	spriteQlen = 0;
+	sprite_frame = 0;
+}
+
 /* Maintenance routines */
 /* Add a rectangle to the update list
-   This is a little bit smart -- if the center nearly overlaps the center
-   of another rectangle update, expand the existing rectangle to include
-   the new area, instead adding another update rectangle.
+   This marks the screen tiles it covers, and remembers the rectangle itself
+   in case it needs to be copied from the background.
 */
 void
 FrameBuf:: AddDirtyRect(SDL_Rect *rect)
 {
-	Uint16  mapoffset;
-	SDL_Rect *newrect;
-
-	/* The dirty map offset is the center of the rectangle */
-	mapoffset = LOWER_PREC(rect->y+(rect->h/2)) * dirtypitch +
-		    LOWER_PREC(rect->x+(rect->w/2));
-
-	if ( dirtymap[mapoffset] == NULL ) {
-		/* New dirty rectangle */
-		if ( updatelen == updatemax ) {
-			/* Expand the updatelist */
-			SDL_Rect *newlist;
-			int       i;
-
-			updatemax += UPDATE_CHUNK;
-			newlist = new SDL_Rect[updatemax+UPDATE_CHUNK];
-			memcpy(newlist,updatelist,updatelen*sizeof(SDL_Rect));
-			/* Update the dirty rectangle map with the new list */
-			for ( i=0; i<dirtymaplen; ++i ) {
-				if ( dirtymap[i] != NULL ) {
-					dirtymap[i] = (SDL_Rect *)(
-					((intptr_t)dirtymap[i]-(intptr_t)updatelist) + (intptr_t)newlist
-					);
-				}
-			}
-			delete[] updatelist;
-			updatelist = newlist;
+	SDL_Rect screen_area;
+
+	if ( screen == screenfg ) {
+		dirty_fg = 1;
+	}
+	dirtytiles.Add(rect);
+
+	if ( exactlen < EXACT_RECTS ) {
+		screen_area.x = 0;
+		screen_area.y = 0;
+		screen_area.w = screen->w;
+		screen_area.h = screen->h;
+		if ( SDL_IntersectRect(rect, &screen_area,
+					&exactlist[exactlen]) ) {
+			++exactlen;
 		}
-		newrect = &updatelist[updatelen];
-		++updatelen;
-		memcpy(newrect, rect, sizeof(*newrect));
-		dirtymap[mapoffset] = newrect;
 	} else {
-		Sint16 x1, y1, x2, y2;
-
-		/* Overlapping dirty rectangle -- expand it */
-		newrect = dirtymap[mapoffset];
-		x1 = MIN(rect->x, newrect->x);
-		y1 = MIN(rect->y, newrect->y);
-		x2 = MAX(rect->x+rect->w, newrect->x+newrect->w);
-		y2 = MAX(rect->y+rect->h, newrect->y+newrect->h);
-		newrect->x = x1;
-		newrect->y = y1;
-		newrect->w = (Uint16)(x2 - x1);
-		newrect->h = (Uint16)(y2 - y1);
+		/* Too many, we'll copy the tiles instead */
+		exactlen = EXACT_RECTS+1;
 	}
 }
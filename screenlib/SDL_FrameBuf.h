@@ -31,12 +31,46 @@
 #include <stdarg.h>
 
 #include "SDL.h"
+#include "dirty.h"
+#include "pool.h"
+
+class ConvertBands;
+class FrameCapture;
+struct ConvertKernel;
 
 typedef enum {
 	DOCLIP,
 	NOCLIP
 } clipval;
 
+/* Options controlling how the screen is presented */
+#define FRAMEBUF_DIRTYUPDATE	0x0001	/* Only upload the changed areas */
+#define FRAMEBUF_RENDERTHREAD	0x0002	/* Convert frames in a separate thread */
+#define FRAMEBUF_BANDCONVERT	0x0004	/* Convert large areas with threads */
+#define FRAMEBUF_HEADLESS	0x0008	/* No display, set before Init() */
+#define FRAMEBUF_NATIVE32	0x0010	/* Draw in 32-bit, set before Init() */
+
+/* Fades go through this many levels, over about 32 refreshes at 60 Hz */
+#define FRAMEBUF_FADE_STEPS	32
+#define FADE_TIME	533
+
+/* Presentation statistics, reset with ResetStats() */
+typedef struct {
+	Uint32 presents;	/* Number of frames presented */
+	Uint32 full_updates;	/* Presents that converted the whole screen */
+	Uint64 converted;	/* 32-bit pixels written to the texture */
+	Uint32 frames;		/* Frames presented by EndFrame() */
+	Uint32 extra_presents;	/* Presents made while a frame was open */
+	Uint32 dropped_frames;	/* Frames replaced before they were presented */
+	Uint32 late_frames;	/* Frames presented a refresh or more late */
+} FrameBufStats;
+
+/* A region of a sprite atlas page, filled in by FrameBuf::AtlasImage() */
+typedef struct {
+	SDL_Surface *page;
+	SDL_Rect area;
+} AtlasFrame;
+
 class FrameBuf {
 
 public:
@@ -54,6 +88,46 @@ public:
 	Uint32 MapRGB(Uint8 R, Uint8 G, Uint8 B);
 	/* Set the blit clipping rectangle */
 	void   ClipBlit(SDL_Rect *cliprect);
+	/* Set the presentation options.
+	   With FRAMEBUF_RENDERTHREAD, finished frames are converted by a
+	   thread of their own while the next one is drawn, and presented
+	   when the next one is finished, a frame late.  The renderer is
+	   only ever used from the calling thread, and doesn't wait for the
+	   vertical blank, so presenting never holds up the game.  Instead
+	   a converted frame is presented at most once a refresh, and left
+	   for a later frame if the last one was presented too recently.
+	   With FRAMEBUF_BANDCONVERT, full screen updates are converted in
+	   bands by a thread per CPU core.
+	   With FRAMEBUF_HEADLESS, Init() doesn't create a window, renderer
+	   or texture, and frames are composed but never presented.  This
+	   has to be set before Init() and can't be changed afterwards.
+	   With FRAMEBUF_NATIVE32, the screen and the images are in the
+	   texture's 32-bit format, with the colors of the palette at the
+	   time they were loaded, so the changed areas are copied to the
+	   texture as they are instead of being converted.  The fades are
+	   done by the renderer, and there's no conversion to split into
+	   bands or scale.  This too has to be set before Init().
+	   This returns -1 if the renderer couldn't be made again for the
+	   render thread being started or stopped.
+	 */
+	int SetOptions(Uint32 flags);
+	Uint32 Options(void) {
+		return(options);
+	}
+	/* Set how many times larger than the screen the texture is, the
+	   scaling is done while converting the changed areas.  A scale of
+	   0 picks the largest one that fits the display.  This returns -1
+	   if the renderer couldn't be made again at the new scale.
+	 */
+	int SetScale(int factor);
+	int Scale(void) {
+		return(scale);
+	}
+
+	/* The refresh rate of the display the window is on, or 60 if it
+	   isn't known or there's no window.
+	 */
+	int RefreshRate(void);
 
 	/* Event Routines */
 	int PollEvent(SDL_Event *event) {
@@ -63,6 +137,9 @@ public:
 		return(SDL_WaitEvent(event));
 	}
 	void ToggleFullScreen(void) {
+		if ( ! window ) {
+			return;
+		}
 		if (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN_DESKTOP) {
 			SDL_SetWindowFullscreen(window, 0);
 		} else {
@@ -81,10 +158,67 @@ public:
 	void QueueBlit(int x, int y, SDL_Surface *src) {
 		QueueBlit(x, y, src, DOCLIP);
 	}
+	void QueueBlit(int x, int y, const AtlasFrame *frame,
+						clipval do_clip = DOCLIP) {
+		/* The page being filled doesn't have its spans yet */
+		if ( frame->page == atlas ) {
+			FinishAtlas();
+		}
+		QueueBlit(x, y, frame->page, frame->area.x, frame->area.y,
+				frame->area.w, frame->area.h, do_clip);
+	}
 	void PerformBlits(void);
 	void Update(int auto_update = 0);
+
+	/* Sprites are composed over the background once a frame:
+	   After StartSprites(), the sprites queued with QueueSprite() replace
+	   the ones of the last sprite frame at the next Update().  Each tile
+	   covered by the old or the new sprites is copied from the background
+	   once and the new sprites over it are drawn in the order they were
+	   queued, so sprites never need to be erased.  Anything drawn on the
+	   foreground after the Update() stays on top of the sprites until
+	   they are composed over it again.
+	   Sprites are always clipped to the blit clipping rectangle.
+	 */
+	void StartSprites(void) {
+		sprite_frame = 1;
+	}
+	void QueueSprite(int dstx, int dsty, SDL_Surface *src,
+					int srcx, int srcy, int w, int h);
+	void QueueSprite(int x, int y, SDL_Surface *src) {
+		QueueSprite(x, y, src, 0, 0, src->w, src->h);
+	}
+	void QueueSprite(int x, int y, const AtlasFrame *frame) {
+		if ( frame->page == atlas ) {
+			FinishAtlas();
+		}
+		QueueSprite(x, y, frame->page, frame->area.x, frame->area.y,
+					frame->area.w, frame->area.h);
+	}
+
+	/* Between BeginFrame() and EndFrame(), Update() composes the changes
+	   into the frame buffer without presenting them, and EndFrame()
+	   presents everything that changed in the frame at once.
+	   If there is no frame open, EndFrame() only carries on a fade
+	   that's under way, so it doesn't stop while nothing is drawn.
+	 */
+	void BeginFrame(void) {
+		in_frame = 1;
+	}
+	void EndFrame(void);
+
 	void UpdateScreen(void);
-	void Fade(void);		/* Fade screen out, then in */
+
+	/* Fade the screen out, or back in, and wait until it's done */
+	void Fade(void);
+	/* Start fading the screen out, or back in, over 'duration' ms.
+	   The fade advances as frames are presented, so the caller can keep
+	   running, and Fading() is true until it's done.
+	 */
+	void StartFade(Uint32 duration = FADE_TIME);
+	int Fading(void) {
+		return(fade_duration != 0);
+	}
 
 	/* Informational routines */
 	Uint16 Width(void) {
@@ -96,6 +230,17 @@ public:
 	SDL_PixelFormat *Format(void) {
 		return(screenfg->format);
 	}
+	/* The composed frame, and the 32-bit ARGB color of each of its
+	   pixel values at the current fade level if it's 8-bit
+	 */
+	SDL_Surface *Frame(void) {
+		return(screenfg);
+	}
+	const Uint32 *FrameColors(void) {
+		return(colormap);
+	}
+	const FrameBufStats *Stats(void);
+	void ResetStats(void);
 
 	/* Set the drawing focus (foreground or background) */
 	void FocusFG(void) {
@@ -119,15 +264,48 @@ public:
 	void DrawRect(Sint16 x1, Sint16 y1, Uint16 w, Uint16 h, Uint32 color);
 	void FillRect(Sint16 x1, Sint16 y1, Uint16 w, Uint16 h, Uint32 color);
 
-	/* Load and convert an 8-bit image with the given mask */
+	/* Load and convert an 8-bit image with the given mask to the format
+	   of the screen.
+	   The runs of opaque pixels in the image are kept in its userdata,
+	   so that queued blits of it can copy just those runs.
+	 */
 	SDL_Surface *LoadImage(Uint16 w, Uint16 h, Uint8 *pixels,
 							Uint8 *mask = NULL);
 	void FreeImage(SDL_Surface *image);
 
-	/* Area copy/dump routines */
+	/* Pack an 8-bit masked image into the sprite atlas.
+	   Images are packed into shelves on tall, narrow pages, so each frame
+	   is a small contiguous block of memory, and 'frame' is filled in with
+	   the page and the area of it holding the image.  The pages are freed
+	   along with the other images.
+	 */
+	int AtlasImage(Uint16 w, Uint16 h, Uint8 *pixels, Uint8 *mask,
+							AtlasFrame *frame);
+	/* Finish the page being filled, the next image starts a new one */
+	void FinishAtlas(void);
+
+	/* Area copy/dump routines
+	   Grabbed areas come from a pool, so saving and restoring the screen
+	   under a dialog doesn't allocate memory once it's been done before.
+	 */
 	SDL_Surface *GrabArea(Uint16 x, Uint16 y, Uint16 w, Uint16 h);
+	const SurfacePoolStats *AreaStats(void) {
+		return(areas->Stats());
+	}
 	int ScreenDump(const char *prefix, Uint16 x, Uint16 y, Uint16 w, Uint16 h);
 
+	/* Record every frame presented to a new file named from 'prefix',
+	   see capture.h for the format.  The frames are written out by a
+	   background thread, this only copies the areas that changed.
+	   If it fails, the capture stops growing, and StopCapture()
+	   returns -1 with the error.
+	 */
+	int StartCapture(const char *prefix);
+	int StopCapture(void);
+	int Capturing(void) {
+		return(capture != NULL);
+	}
+
 	/* Cursor handling routines */
 	void ShowCursor(void) {
 		SDL_ShowCursor(1);
@@ -136,7 +314,9 @@ public:
 		SDL_ShowCursor(0);
 	}
 	void SetCaption(const char *caption) {
-		SDL_SetWindowTitle(window, caption);
+		if ( window ) {
+			SDL_SetWindowTitle(window, caption);
+		}
 	}
 
 	/* Error message routine */
@@ -155,9 +335,102 @@ private:
 	SDL_Surface *screenbg;
 	SDL_Palette *palette;
 	Uint8 *screen_mem;
-	Uint32 colormap[256];
+	Uint32 *colormap;		/* The map for the current fade level */
 	int faded;
 
+	/* The palette mapped at each fade level, from black to full color */
+	Uint32 fademaps[FRAMEBUF_FADE_STEPS+1][256];
+	int fade_level;
+	Uint32 fade_start;
+	Uint32 fade_duration;		/* Set while a fade is under way */
+	void AdvanceFade(void);
+	Uint32 options;
+	FrameBufStats stats;
+
+	/* Set when the texture no longer matches the screen */
+	int full_update;
+
+	/* Set between BeginFrame() and EndFrame() */
+	int in_frame;
+
+	/* Areas of the foreground composed but not presented yet */
+	DirtyTiles pendingtiles;
+	void Present(void);
+	/* Watches the events as they're queued, so every event loop sees
+	   the texture being lost, whether it polls through us or not.
+	 */
+	static int SDLCALL WatchEvent(void *userdata, SDL_Event *event);
+	int CreateRenderer(void);
+	void DestroyRenderer(void);
+	int ResetRenderer(void);
+	int RenderScreen(const Uint8 *pixels, int pitch, const Uint32 *map,
+			int fade, SDL_Rect *rects, int numrects, int full,
+						FrameBufStats *counts);
+	void ConvertArea(const SDL_Rect *area, const Uint8 *src, int srcpitch,
+			const Uint32 *map, Uint8 *pixels, int pitch);
+	ConvertBands *bands;		/* Used for large areas, if set */
+	FrameCapture *capture;		/* Set while capturing the frames */
+	int capture_full;		/* Changes were made outside the rects */
+	int scale, scale_request;	/* Texture pixels per screen pixel */
+	void SetupBands(void);
+
+	/* Frames handed to the render thread through a triple buffer:
+	   The game thread fills its back slot and swaps it with the latest
+	   slot, the render thread swaps its front slot with the latest slot
+	   when that has a frame it hasn't taken yet.  A frame replaced before
+	   the render thread took it is dropped, so its changed areas are
+	   carried into the following frames until one of them is taken.
+	   The render thread converts the frame it took into render_pixels,
+	   which the game thread uploads to the texture and presents, since
+	   the renderer can only be used from the thread that created it.
+	 */
+#define RENDER_SLOTS	3
+#define RENDER_FRESH	0x4	/* Set on the latest slot until it's taken */
+	typedef struct {
+		Uint8 *pixels;
+		Uint32 colormap[256];
+		int fade_level;
+		DirtyTiles tiles;
+		int full_update;
+		Uint32 sequence;
+		Uint64 finished;	/* Performance counter when handed over */
+	} RenderSlot;
+	RenderSlot render_slots[RENDER_SLOTS];
+	SDL_atomic_t render_latest;
+	int render_back;		/* Only used by the game thread */
+	int render_front;		/* Only used by the render thread */
+	DirtyTiles frametiles;		/* Changed areas of the frame */
+	DirtyTiles carrytiles;		/* Changed areas since the last taken */
+	int carry_full;
+	Uint32 render_sequence;		/* The last frame handed over */
+
+	SDL_Thread *render_thread;
+	SDL_sem *render_ready;		/* Posted for every frame handed over */
+	SDL_atomic_t render_quit;
+	SDL_mutex *render_lock;
+	SDL_cond *render_done;		/* Signaled when render_converted changes */
+	Uint8 *render_pixels;		/* The converted frame, texture sized */
+	int render_pitch;
+	SDL_Rect *render_rects;		/* Only used by the game thread */
+	Uint64 render_refresh;		/* Performance counts per refresh */
+	Uint64 render_due;		/* When the next present may be made */
+	int render_converted;		/* Set until render_pixels is uploaded */
+	DirtyTiles render_tiles;	/* These are protected by render_lock */
+	int render_full;
+	int render_fade;
+	Uint32 render_frame;		/* The frame in render_pixels */
+	Uint64 render_finished;
+	Uint32 render_presented;
+	FrameBufStats render_stats;
+	int StartRenderThread(void);
+	int TryRenderThread(void);
+	void StopRenderThread(void);
+	static int RenderThread(void *data);
+	int RunRenderThread(void);
+	void HandOver(void);
+	void PresentConverted(int wait);
+	int WholeScreen(const SDL_Rect *rects, int numrects);
+
 	/* Error message */
 	void SetError(const char *fmt, ...) {
 		va_list ap;
@@ -180,19 +453,40 @@ private:
 	BlitQ *blitQ;
 	int blitQlen;
 	int blitQmax;
+	int ClipQueued(BlitQ *blit, int dstx, int dsty, SDL_Surface *src,
+			int srcx, int srcy, int w, int h, clipval do_clip);
+
+	/* Sprites queued for the next composition, and the areas covered
+	   by the sprites composed last.
+	 */
+	BlitQ *spriteQ;
+	int spriteQlen;
+	int spriteQmax;
+	SDL_Rect *lastsprites;
+	int lastspriteslen;
+	int lastspritesmax;
+	int sprite_frame;		/* Set by StartSprites() */
+	DirtyTiles spritetiles;
+	SDL_Rect *spriterects;
+	void ComposeSprites(void);
 
-	/* Rectangle update list */
-#define UPDATE_CHUNK	QUEUE_CHUNK*2
+	/* Rectangle update list, built from the dirty tiles at update time.
+	   The exact rectangles are also kept, up to a point, so that areas
+	   copied from the background don't cover more than was drawn.
+	 */
+#define EXACT_RECTS	128
 	void AddDirtyRect(SDL_Rect *rect);
+	DirtyTiles dirtytiles;
 	int updatelen;
-	int updatemax;
 	SDL_Rect *updatelist;
-	Uint16 dirtypitch;
-	SDL_Rect **dirtymap;
-	Uint16 dirtymaplen;
+	int exactlen;
+	SDL_Rect exactlist[EXACT_RECTS];
+	int dirty_fg;
 	void ClearDirtyList(void) {
+		dirtytiles.Clear();
 		updatelen = 0;
-		memset(dirtymap, 0, dirtymaplen*sizeof(SDL_Rect *));
+		exactlen = 0;
+		dirty_fg = 0;
 	}
 
 	/* Background color */
@@ -202,15 +496,45 @@ private:
 	/* Blit clipping rectangle */
 	SDL_Rect clip;
 
+	/* Runs of opaque pixels in a loaded image, for the span blitter */
+	typedef struct {
+		Uint16 x, w;
+	} ImageSpan;
+	typedef struct {
+		int *rows;		/* First span of each row, and the end */
+		ImageSpan *spans;
+	} ImageSpans;
+	void BuildSpans(SDL_Surface *image, int use_key, Uint32 colorkey,
+						const Uint8 *opaque = NULL);
+	void BlitSpans(SDL_Surface *src, SDL_Rect *srcrect,
+						SDL_Rect *dstrect);
+	static void ReleaseImage(SDL_Surface *image);
+	SurfacePool *areas;		/* Surfaces for GrabArea() */
+
 	/* List of loaded images */
 	typedef struct image_list {
 		SDL_Surface *image;
 		struct image_list *next;
 	} image_list;
 	image_list images, *itail;
+	SDL_Surface *CreateImage(Uint16 w, Uint16 h);
+	/* The colors 8-bit artwork is mapped to in an image, or NULL */
+	const Uint32 *ArtworkMap(SDL_Surface *image) {
+		return(image->format->palette ?
+				NULL : fademaps[FRAMEBUF_FADE_STEPS]);
+	}
+	void AddImage(SDL_Surface *image);
+
+	/* The sprite atlas page being filled */
+#define ATLAS_PAGE_WIDTH	32
+#define ATLAS_PAGE_HEIGHT	4096
+	SDL_Surface *atlas;
+	Uint8 *atlas_opaque;	/* One byte per page pixel, set where opaque */
+	int atlas_x, atlas_y;	/* Where the next image goes on the shelf */
+	int atlas_shelf;	/* The height of the current shelf */
 	
-	/* Function to write to the display surface */
-	void (*PutPixel)(Uint8 *screen_loc, SDL_Surface *screen, Uint32 pixel);
+	/* The kernel used to expand the display into the texture */
+	const struct ConvertKernel *kernel;
 };
 
 #endif /* _SDL_FrameBuf_h */
@@ -0,0 +1,368 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "dirty.h"
+#include "capture.h"
+
+static inline Uint8 *Put16(Uint8 *out, Uint16 value)
+{
+	out[0] = (Uint8)value;
+	out[1] = (Uint8)(value >> 8);
+	return(out+2);
+}
+static inline Uint8 *Put32(Uint8 *out, Uint32 value)
+{
+	out[0] = (Uint8)value;
+	out[1] = (Uint8)(value >> 8);
+	out[2] = (Uint8)(value >> 16);
+	out[3] = (Uint8)(value >> 24);
+	return(out+4);
+}
+
+/* Encode a row of pixels as runs, skipping the pixels that match 'prev'
+   unless it's NULL.  A run of copied pixels stops where a skip or a fill
+   of at least two pixels could start.
+ */
+static Uint8 *EncodeRow(Uint8 *out, const Uint8 *row, const Uint8 *prev,
+								int width)
+{
+	int x, n, max;
+
+	for ( x = 0; x < width; x += n ) {
+		max = SDL_min(width-x, CAPTURE_RUN);
+		if ( prev && (row[x] == prev[x]) ) {
+			for ( n = 1; (n < max) && (row[x+n] == prev[x+n]); ++n )
+				;
+			*out++ = CAPTURE_SKIP|(n-1);
+		} else if ( (max > 1) && (row[x+1] == row[x]) ) {
+			for ( n = 2; (n < max) && (row[x+n] == row[x]); ++n )
+				;
+			*out++ = CAPTURE_FILL|(n-1);
+			*out++ = row[x];
+		} else {
+			for ( n = 1; n < max; ++n ) {
+				if ( prev && (row[x+n] == prev[x+n]) ) {
+					break;
+				}
+				if ( (n+1 < max) && (row[x+n+1] == row[x+n]) ) {
+					break;
+				}
+			}
+			*out++ = CAPTURE_COPY|(n-1);
+			memcpy(out, &row[x], n);
+			out += n;
+		}
+	}
+	return(out);
+}
+
+FrameCapture:: FrameCapture()
+{
+	fp = NULL;
+	width = height = 0;
+	start = 0;
+	dropped = 0;
+	keyframe = 1;
+	colormap_sent = 0;
+	merged = NULL;
+	frames = NULL;
+	head = tail = queued = 0;
+	quit = 0;
+	failed = 0;
+	lock = NULL;
+	changed = NULL;
+	writer = NULL;
+	last = NULL;
+	output = NULL;
+	errstr = NULL;
+}
+
+FrameCapture:: ~FrameCapture()
+{
+	int i;
+
+	Close();
+	if ( changed ) {
+		SDL_DestroyCond(changed);
+	}
+	if ( lock ) {
+		SDL_DestroyMutex(lock);
+	}
+	if ( frames ) {
+		for ( i = 0; i < CAPTURE_QUEUE; ++i ) {
+			delete[] frames[i].pixels;
+		}
+		delete[] frames;
+	}
+	if ( merged ) {
+		delete[] merged;
+	}
+	if ( last ) {
+		delete[] last;
+	}
+	if ( output ) {
+		delete[] output;
+	}
+}
+
+int
+FrameCapture:: Close(void)
+{
+	int status;
+
+	status = 0;
+	if ( writer ) {
+		SDL_LockMutex(lock);
+		quit = 1;
+		SDL_CondSignal(changed);
+		SDL_UnlockMutex(lock);
+		SDL_WaitThread(writer, &status);
+		writer = NULL;
+	}
+	if ( fp ) {
+		if ( (fclose(fp) != 0) && (status == 0) ) {
+			SetError("Couldn't close the capture file");
+			status = -1;
+		}
+		fp = NULL;
+	}
+	return(status);
+}
+
+int
+FrameCapture:: Open(const char *file, int w, int h)
+{
+	Uint8 header[12];
+	int i;
+
+	width = w;
+	height = h;
+	fp = fopen(file, "wb");
+	if ( fp == NULL ) {
+		SetError("Couldn't open %s for writing", file);
+		return(-1);
+	}
+	memcpy(header, CAPTURE_MAGIC, 8);
+	Put16(Put16(&header[8], width), height);
+	if ( fwrite(header, sizeof(header), 1, fp) != 1 ) {
+		SetError("Couldn't write to %s", file);
+		return(-1);
+	}
+
+	/* Each frame has room for the whole screen, and the record for it
+	   can't be bigger than the flags, colormap and areas, plus two bytes
+	   for every pixel, a copied run of one.
+	 */
+	frames = new CaptureFrame[CAPTURE_QUEUE];
+	for ( i = 0; i < CAPTURE_QUEUE; ++i ) {
+		frames[i].pixels = new Uint8[width*height];
+	}
+	last = new Uint8[width*height];
+	missed.Init(width, height);
+	merged = new SDL_Rect[missed.MaxRects()];
+	output = new Uint8[4+1+sizeof(colormap)+2+CAPTURE_MAX_RECTS*8+
+							2*width*height];
+
+	lock = SDL_CreateMutex();
+	changed = SDL_CreateCond();
+	if ( (lock == NULL) || (changed == NULL) ) {
+		SetError("Couldn't create capture thread: %s", SDL_GetError());
+		return(-1);
+	}
+	writer = SDL_CreateThread(WriterThread, "FrameCapture", this);
+	if ( writer == NULL ) {
+		SetError("Couldn't create capture thread: %s", SDL_GetError());
+		return(-1);
+	}
+	start = SDL_GetTicks();
+	return(0);
+}
+
+int
+FrameCapture:: AddFrame(SDL_Surface *screen, const SDL_Rect *rects,
+				int numrects, int full, const Uint32 *map)
+{
+	CaptureFrame *frame;
+	Uint8 *src, *dst;
+	int i, row;
+
+	SDL_LockMutex(lock);
+	if ( failed ) {
+		SDL_UnlockMutex(lock);
+		return(-1);
+	}
+	if ( queued == CAPTURE_QUEUE ) {
+		SDL_UnlockMutex(lock);
+
+		/* The areas of this frame go out with the next one */
+		++dropped;
+		if ( full ) {
+			keyframe = 1;
+		} else {
+			for ( i = 0; i < numrects; ++i ) {
+				missed.Add(&rects[i]);
+			}
+		}
+		return(0);
+	}
+	frame = &frames[tail];
+	SDL_UnlockMutex(lock);
+
+	if ( ! missed.Empty() ) {
+		for ( i = 0; i < numrects; ++i ) {
+			missed.Add(&rects[i]);
+		}
+		numrects = missed.Build(merged);
+		rects = merged;
+		missed.Clear();
+	}
+
+	frame->time = SDL_GetTicks() - start;
+	frame->flags = 0;
+	if ( ! colormap_sent || memcmp(map, colormap, sizeof(colormap)) ) {
+		memcpy(colormap, map, sizeof(colormap));
+		memcpy(frame->colormap, map, sizeof(colormap));
+		frame->flags |= CAPTURE_COLORMAP;
+		colormap_sent = 1;
+	}
+	if ( keyframe || full || (numrects > CAPTURE_MAX_RECTS) ) {
+		frame->flags |= CAPTURE_KEYFRAME;
+		frame->numrects = 1;
+		frame->rects[0].x = 0;
+		frame->rects[0].y = 0;
+		frame->rects[0].w = width;
+		frame->rects[0].h = height;
+		keyframe = 0;
+	} else {
+		frame->numrects = numrects;
+		memcpy(frame->rects, rects, numrects*sizeof(*rects));
+	}
+
+	/* The areas don't overlap, so they all fit in one screen's worth */
+	dst = frame->pixels;
+	for ( i = 0; i < frame->numrects; ++i ) {
+		src = (Uint8 *)screen->pixels + frame->rects[i].y*screen->pitch +
+							frame->rects[i].x;
+		for ( row = frame->rects[i].h; row--; ) {
+			memcpy(dst, src, frame->rects[i].w);
+			dst += frame->rects[i].w;
+			src += screen->pitch;
+		}
+	}
+
+	SDL_LockMutex(lock);
+	tail = (tail+1)%CAPTURE_QUEUE;
+	++queued;
+	SDL_CondSignal(changed);
+	SDL_UnlockMutex(lock);
+	return(0);
+}
+
+int
+FrameCapture:: WriterThread(void *data)
+{
+	return(((FrameCapture *)data)->RunWriter());
+}
+
+int
+FrameCapture:: RunWriter(void)
+{
+	CaptureFrame *frame;
+	int status;
+
+	status = 0;
+	SDL_LockMutex(lock);
+	for ( ; ; ) {
+		while ( !queued && !quit ) {
+			SDL_CondWait(changed, lock);
+		}
+		if ( !queued ) {
+			break;
+		}
+		frame = &frames[head];
+		SDL_UnlockMutex(lock);
+
+		/* After an error, drop the frames that were already queued */
+		if ( (status == 0) && (WriteFrame(frame) < 0) ) {
+			SetError("Couldn't write the capture file");
+			status = -1;
+		}
+
+		SDL_LockMutex(lock);
+		if ( status < 0 ) {
+			failed = 1;
+		}
+		head = (head+1)%CAPTURE_QUEUE;
+		--queued;
+	}
+	SDL_UnlockMutex(lock);
+
+	if ( (status == 0) && (fflush(fp) != 0) ) {
+		SetError("Couldn't write the capture file");
+		status = -1;
+	}
+	return(status);
+}
+
+int
+FrameCapture:: WriteFrame(CaptureFrame *frame)
+{
+	Uint8 *out, *src, *prev;
+	const SDL_Rect *rect;
+	int i, row;
+
+	out = output;
+	out = Put32(out, frame->time);
+	*out++ = (Uint8)frame->flags;
+	if ( frame->flags & CAPTURE_COLORMAP ) {
+		for ( i = 0; i < 256; ++i ) {
+			out = Put32(out, frame->colormap[i]);
+		}
+	}
+	out = Put16(out, frame->numrects);
+
+	src = frame->pixels;
+	for ( i = 0; i < frame->numrects; ++i ) {
+		rect = &frame->rects[i];
+		out = Put16(out, rect->x);
+		out = Put16(out, rect->y);
+		out = Put16(out, rect->w);
+		out = Put16(out, rect->h);
+		prev = last + rect->y*width + rect->x;
+		for ( row = rect->h; row--; ) {
+			if ( frame->flags & CAPTURE_KEYFRAME ) {
+				out = EncodeRow(out, src, NULL, rect->w);
+			} else {
+				out = EncodeRow(out, src, prev, rect->w);
+			}
+			memcpy(prev, src, rect->w);
+			src += rect->w;
+			prev += width;
+		}
+	}
+	if ( fwrite(output, out-output, 1, fp) != 1 ) {
+		return(-1);
+	}
+	return(0);
+}
@@ -0,0 +1,143 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _capture_h
+#define _capture_h
+
+/* A capture of the 8-bit screen, one record for each frame presented:
+
+   AddFrame() copies just the changed areas of the frame into a queue,
+   and a writer thread compares them to the last frame and appends them
+   to the file, run length encoded.  If the writer falls behind and the
+   queue is full, the frame is dropped and its areas are added to the
+   next one.  Once the writer fails, no more frames are queued, and
+   Close() returns the error.
+
+   The file starts with the magic "MAELCAP1" and the Uint16 width and
+   height of the screen.  Each frame record is, all little endian:
+	Uint32 time		Milliseconds since the capture started
+	Uint8 flags		CAPTURE_COLORMAP and CAPTURE_KEYFRAME
+	Uint32 colormap[256]	ARGB colors, only with CAPTURE_COLORMAP
+	Uint16 numrects
+	For each area:
+		Uint16 x, y, w, h
+		For each row, runs covering its 'w' pixels.  Each run is a
+		byte with the type in the top two bits and the length minus
+		one in the bottom six:
+		CAPTURE_SKIP	The pixels haven't changed since the last frame
+		CAPTURE_COPY	The pixels follow
+		CAPTURE_FILL	A pixel follows, repeated for the run
+   A keyframe covers the screen without any skipped runs, so decoding can
+   start from it.
+*/
+
+#define CAPTURE_MAGIC		"MAELCAP1"
+
+#define CAPTURE_COLORMAP	0x01
+#define CAPTURE_KEYFRAME	0x02
+
+#define CAPTURE_SKIP		0x00
+#define CAPTURE_COPY		0x40
+#define CAPTURE_FILL		0x80
+#define CAPTURE_RUN		64	/* The longest run */
+
+#define CAPTURE_QUEUE		8	/* Frames waiting to be written */
+#define CAPTURE_MAX_RECTS	256	/* More areas make a keyframe */
+
+class FrameCapture {
+
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	int Open(const char *file, int width, int height);
+
+	/* Write out the queued frames and close the file, returning -1 if
+	   any of it couldn't be written.
+	 */
+	int Close(void);
+
+	/* Queue the areas of an 8-bit screen that changed since the last
+	   frame, 'full' if the pixels may have changed anywhere.  This
+	   returns -1 without queueing it if the writer has failed.
+	 */
+	int AddFrame(SDL_Surface *screen, const SDL_Rect *rects, int numrects,
+					int full, const Uint32 *colormap);
+
+	/* The number of frames dropped because the queue was full */
+	Uint32 Dropped(void) {
+		return(dropped);
+	}
+
+	/* Error message routine */
+	char *Error(void) {
+		return(errstr);
+	}
+
+private:
+	FILE *fp;
+	int width, height;
+	Uint32 start;
+	Uint32 dropped;
+
+	/* Kept by AddFrame() */
+	int keyframe;			/* Set when the next frame needs one */
+	DirtyTiles missed;		/* Areas of the dropped frames */
+	SDL_Rect *merged;
+	int colormap_sent;
+	Uint32 colormap[256];
+
+	/* The queue of frames, from 'head' to the frame before 'tail' */
+	typedef struct {
+		Uint32 time;
+		int flags;
+		Uint32 colormap[256];
+		int numrects;
+		SDL_Rect rects[CAPTURE_MAX_RECTS];
+		Uint8 *pixels;		/* The areas, one after another */
+	} CaptureFrame;
+	CaptureFrame *frames;
+	int head, tail, queued;		/* These are protected by 'lock' */
+	int quit;
+	int failed;			/* Set by the writer when it fails */
+	SDL_mutex *lock;
+	SDL_cond *changed;
+	SDL_Thread *writer;
+
+	/* Used by the writer thread */
+	Uint8 *last;			/* The last frame written */
+	Uint8 *output;			/* The record being encoded */
+	static int WriterThread(void *data);
+	int RunWriter(void);
+	int WriteFrame(CaptureFrame *frame);
+
+	/* Error message */
+	void SetError(const char *fmt, ...) {
+		va_list ap;
+
+		va_start(ap, fmt);
+		SDL_vsnprintf(errbuf, sizeof(errbuf), fmt, ap);
+		va_end(ap);
+		errstr = errbuf;
+	}
+	char *errstr;
+	char  errbuf[1024];
+};
+
+#endif /* _capture_h */
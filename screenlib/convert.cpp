@@ -0,0 +1,406 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <string.h>
+
+#include "SDL.h"
+#include "convert.h"
+
+/* The vector kernels are compiled with per-function target attributes,
+   so the rest of the library doesn't need to be built for a newer CPU.
+   Which one actually runs is decided at runtime by BestConvertKernel().
+*/
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define CONVERT_SSE2
+#define CONVERT_AVX2
+#define CONVERT_TARGET(X)	__attribute__((target(X)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define CONVERT_SSE2
+#define CONVERT_AVX2
+#define CONVERT_TARGET(X)
+#endif
+
+#if defined(CONVERT_SSE2) || defined(CONVERT_AVX2)
+#include <immintrin.h>
+#endif
+
+
+/* The plain C version, one table lookup per pixel */
+static void ConvertRow_Scalar(const Uint8 *src, Uint32 *dst, int width,
+						const Uint32 *colormap)
+{
+	while ( width-- ) {
+		*dst++ = colormap[*src++];
+	}
+}
+static void ConvertScaled_Scalar(const Uint8 *src, Uint32 *dst, int width,
+					const Uint32 *colormap, int scale)
+{
+	Uint32 color;
+	int i;
+
+	while ( width-- ) {
+		color = colormap[*src++];
+		for ( i = scale; i; --i ) {
+			*dst++ = color;
+		}
+	}
+}
+static SDL_bool Available_Scalar(void)
+{
+	return(SDL_TRUE);
+}
+
+#ifdef CONVERT_SSE2
+/* SSE2 has no gather, so the lookups are still done with scalar loads,
+   but the source is read eight pixels at a time and the results are
+   written out sixteen bytes at a time.
+ */
+CONVERT_TARGET("sse2")
+static void ConvertRow_SSE2(const Uint8 *src, Uint32 *dst, int width,
+						const Uint32 *colormap)
+{
+	Uint64 p0, p1;
+
+	while ( width >= 16 ) {
+		memcpy(&p0, src, sizeof(p0));
+		memcpy(&p1, src+8, sizeof(p1));
+		_mm_storeu_si128((__m128i *)(dst+0), _mm_setr_epi32(
+			colormap[(p0 >>  0) & 0xFF], colormap[(p0 >>  8) & 0xFF],
+			colormap[(p0 >> 16) & 0xFF], colormap[(p0 >> 24) & 0xFF]));
+		_mm_storeu_si128((__m128i *)(dst+4), _mm_setr_epi32(
+			colormap[(p0 >> 32) & 0xFF], colormap[(p0 >> 40) & 0xFF],
+			colormap[(p0 >> 48) & 0xFF], colormap[(p0 >> 56) & 0xFF]));
+		_mm_storeu_si128((__m128i *)(dst+8), _mm_setr_epi32(
+			colormap[(p1 >>  0) & 0xFF], colormap[(p1 >>  8) & 0xFF],
+			colormap[(p1 >> 16) & 0xFF], colormap[(p1 >> 24) & 0xFF]));
+		_mm_storeu_si128((__m128i *)(dst+12), _mm_setr_epi32(
+			colormap[(p1 >> 32) & 0xFF], colormap[(p1 >> 40) & 0xFF],
+			colormap[(p1 >> 48) & 0xFF], colormap[(p1 >> 56) & 0xFF]));
+		src += 16;
+		dst += 16;
+		width -= 16;
+	}
+	ConvertRow_Scalar(src, dst, width, colormap);
+}
+/* Each group of four colors is repeated with shuffles */
+CONVERT_TARGET("sse2")
+static void ConvertScaled_SSE2(const Uint8 *src, Uint32 *dst, int width,
+					const Uint32 *colormap, int scale)
+{
+	__m128i v;
+
+	while ( width >= 4 ) {
+		v = _mm_setr_epi32(colormap[src[0]], colormap[src[1]],
+					colormap[src[2]], colormap[src[3]]);
+		switch (scale) {
+		    case 2:
+			_mm_storeu_si128((__m128i *)(dst+0),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(1,1,0,0)));
+			_mm_storeu_si128((__m128i *)(dst+4),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,2,2)));
+			break;
+		    case 3:
+			_mm_storeu_si128((__m128i *)(dst+0),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,0,0)));
+			_mm_storeu_si128((__m128i *)(dst+4),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(2,2,1,1)));
+			_mm_storeu_si128((__m128i *)(dst+8),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,2)));
+			break;
+		    case 4:
+			_mm_storeu_si128((__m128i *)(dst+0),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(0,0,0,0)));
+			_mm_storeu_si128((__m128i *)(dst+4),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(1,1,1,1)));
+			_mm_storeu_si128((__m128i *)(dst+8),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(2,2,2,2)));
+			_mm_storeu_si128((__m128i *)(dst+12),
+				_mm_shuffle_epi32(v, _MM_SHUFFLE(3,3,3,3)));
+			break;
+		}
+		src += 4;
+		dst += 4*scale;
+		width -= 4;
+	}
+	ConvertScaled_Scalar(src, dst, width, colormap, scale);
+}
+static SDL_bool Available_SSE2(void)
+{
+	return(SDL_HasSSE2());
+}
+#endif /* CONVERT_SSE2 */
+
+#ifdef CONVERT_AVX2
+/* AVX2 widens sixteen pixels to 32-bit indices and gathers the
+   colormap entries eight at a time.
+ */
+CONVERT_TARGET("avx2")
+static void ConvertRow_AVX2(const Uint8 *src, Uint32 *dst, int width,
+						const Uint32 *colormap)
+{
+	const int *table = (const int *)colormap;
+	__m128i pixels;
+	__m256i lo, hi;
+
+	while ( width >= 16 ) {
+		pixels = _mm_loadu_si128((const __m128i *)src);
+		lo = _mm256_cvtepu8_epi32(pixels);
+		hi = _mm256_cvtepu8_epi32(_mm_srli_si128(pixels, 8));
+		lo = _mm256_i32gather_epi32(table, lo, 4);
+		hi = _mm256_i32gather_epi32(table, hi, 4);
+		_mm256_storeu_si256((__m256i *)(dst+0), lo);
+		_mm256_storeu_si256((__m256i *)(dst+8), hi);
+		src += 16;
+		dst += 16;
+		width -= 16;
+	}
+	ConvertRow_Scalar(src, dst, width, colormap);
+}
+/* Each gather of eight colors is spread over 'scale' vectors, vector 'k'
+   lane 'j' holding color (k*8+j)/scale.
+ */
+CONVERT_TARGET("avx2")
+static void ConvertScaled_AVX2(const Uint8 *src, Uint32 *dst, int width,
+					const Uint32 *colormap, int scale)
+{
+	const int *table = (const int *)colormap;
+	int lanes[8], j, k;
+	__m256i spread[CONVERT_MAX_SCALE], v;
+
+	for ( k = 0; k < scale; ++k ) {
+		for ( j = 0; j < 8; ++j ) {
+			lanes[j] = (k*8+j)/scale;
+		}
+		spread[k] = _mm256_loadu_si256((const __m256i *)lanes);
+	}
+	while ( width >= 8 ) {
+		v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+		v = _mm256_i32gather_epi32(table, v, 4);
+		for ( k = 0; k < scale; ++k ) {
+			_mm256_storeu_si256((__m256i *)(dst+k*8),
+				_mm256_permutevar8x32_epi32(v, spread[k]));
+		}
+		src += 8;
+		dst += 8*scale;
+		width -= 8;
+	}
+	ConvertScaled_Scalar(src, dst, width, colormap, scale);
+}
+static SDL_bool Available_AVX2(void)
+{
+	return(SDL_HasAVX2());
+}
+#endif /* CONVERT_AVX2 */
+
+const ConvertKernel convert_kernels[] = {
+	{ "scalar",	ConvertRow_Scalar,	ConvertScaled_Scalar,
+							Available_Scalar },
+#ifdef CONVERT_SSE2
+	{ "sse2",	ConvertRow_SSE2,	ConvertScaled_SSE2,
+							Available_SSE2 },
+#endif
+#ifdef CONVERT_AVX2
+	{ "avx2",	ConvertRow_AVX2,	ConvertScaled_AVX2,
+							Available_AVX2 },
+#endif
+	{ NULL,		NULL,			NULL,	NULL }
+};
+
+const ConvertKernel *BestConvertKernel(void)
+{
+	const ConvertKernel *kernel, *best;
+
+	best = &convert_kernels[0];
+	for ( kernel = convert_kernels; kernel->name; ++kernel ) {
+		if ( kernel->available() ) {
+			best = kernel;
+		}
+	}
+	return(best);
+}
+
+/* Scaled rows are expanded a piece at a time into a buffer that stays in
+   the cache, and copied from there to each destination row, so the
+   destination is only written, never read back.
+ */
+#define CONVERT_PIECE	256
+
+void ConvertRows(const ConvertKernel *kernel,
+			const Uint8 *src, int srcpitch, const Uint32 *colormap,
+			Uint8 *dst, int dstpitch, int width, int height,
+								int scale)
+{
+	Uint32 piece[CONVERT_PIECE*CONVERT_MAX_SCALE];
+	int x, w, i;
+
+	if ( scale == 1 ) {
+		while ( height-- ) {
+			kernel->convert(src, (Uint32 *)dst, width, colormap);
+			src += srcpitch;
+			dst += dstpitch;
+		}
+		return;
+	}
+	while ( height-- ) {
+		for ( x = 0; x < width; x += w ) {
+			w = SDL_min(width-x, CONVERT_PIECE);
+			kernel->scaled(src+x, piece, w, colormap, scale);
+			for ( i = 0; i < scale; ++i ) {
+				memcpy(dst + i*dstpitch + x*scale*sizeof(Uint32),
+					piece, w*scale*sizeof(Uint32));
+			}
+		}
+		src += srcpitch;
+		dst += scale*dstpitch;
+	}
+}
+
+/* How many times to check for the workers before yielding to them */
+#define CONVERT_JOIN_SPINS	4096
+
+ConvertBands:: ConvertBands()
+{
+	numthreads = 1;
+	wakeup = NULL;
+	SDL_AtomicSet(&quit, 0);
+	SDL_AtomicSet(&untaken, 0);
+	SDL_AtomicSet(&unfinished, 0);
+	job_bands = 0;
+}
+
+ConvertBands:: ~ConvertBands()
+{
+	int i;
+
+	SDL_AtomicSet(&quit, 1);
+	for ( i = 1; i < numthreads; ++i ) {
+		SDL_SemPost(wakeup);
+	}
+	for ( i = 1; i < numthreads; ++i ) {
+		SDL_WaitThread(workers[i], NULL);
+	}
+	if ( wakeup ) {
+		SDL_DestroySemaphore(wakeup);
+	}
+}
+
+int
+ConvertBands:: Init(int threads)
+{
+	if ( threads <= 0 ) {
+		threads = SDL_GetCPUCount();
+	}
+	threads = SDL_max(SDL_min(threads, CONVERT_MAX_THREADS), 1);
+
+	wakeup = SDL_CreateSemaphore(0);
+	if ( wakeup == NULL ) {
+		return(-1);
+	}
+	/* Slot 0 is the calling thread */
+	for ( numthreads = 1; numthreads < threads; ++numthreads ) {
+		workers[numthreads] = SDL_CreateThread(Worker,
+						"ConvertBands", this);
+		if ( workers[numthreads] == NULL ) {
+			break;
+		}
+	}
+	return(0);
+}
+
+int
+ConvertBands:: Worker(void *data)
+{
+	ConvertBands *pool = (ConvertBands *)data;
+
+	while ( SDL_SemWait(pool->wakeup) == 0 ) {
+		if ( SDL_AtomicGet(&pool->quit) ) {
+			break;
+		}
+		pool->ConvertBand();
+	}
+	return(0);
+}
+
+/* Take bands and convert them until there are none left.
+   A worker woken after the bands were all taken finds none, and goes back
+   to sleep without looking at the job, which may be changing by then.
+ */
+void
+ConvertBands:: ConvertBand(void)
+{
+	int left, row, rows;
+
+	while ( (left = SDL_AtomicAdd(&untaken, -1)) > 0 ) {
+		row = (job_bands-left)*job_bandrows;
+		rows = SDL_min(job_bandrows, job_height-row);
+		ConvertRows(job_kernel, job_src + row*job_srcpitch,
+			job_srcpitch, job_colormap,
+			job_dst + row*job_scale*job_dstpitch, job_dstpitch,
+			job_width, rows, job_scale);
+		SDL_AtomicAdd(&unfinished, -1);
+	}
+}
+
+void
+ConvertBands:: Convert(const ConvertKernel *kernel,
+			const Uint8 *src, int srcpitch, const Uint32 *colormap,
+			Uint8 *dst, int dstpitch, int width, int height,
+								int scale)
+{
+	int bands, spins;
+
+	bands = SDL_min(numthreads, height/CONVERT_BAND_ROWS);
+	if ( bands <= 1 ) {
+		ConvertRows(kernel, src, srcpitch, colormap,
+				dst, dstpitch, width, height, scale);
+		return;
+	}
+
+	/* Nobody can take a band now, so the job can be changed */
+	job_kernel = kernel;
+	job_src = src;
+	job_srcpitch = srcpitch;
+	job_colormap = colormap;
+	job_dst = dst;
+	job_dstpitch = dstpitch;
+	job_width = width;
+	job_height = height;
+	job_scale = scale;
+	job_bandrows = (height+bands-1)/bands;
+	bands = (height+job_bandrows-1)/job_bandrows;
+	job_bands = bands;
+	SDL_AtomicSet(&unfinished, bands);
+	SDL_AtomicSet(&untaken, bands);
+
+	/* Fork: wake the workers and take bands along with them */
+	while ( --bands ) {
+		SDL_SemPost(wakeup);
+	}
+	ConvertBand();
+
+	/* Join: the remaining bands are already being converted, so spin for
+	   a while, and then give the workers a chance if they were preempted.
+	 */
+	for ( spins = 0; SDL_AtomicGet(&unfinished) > 0; ++spins ) {
+		if ( spins >= CONVERT_JOIN_SPINS ) {
+			SDL_Delay(0);
+		}
+	}
+}
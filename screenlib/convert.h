@@ -0,0 +1,113 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _convert_h
+#define _convert_h
+
+/* Palette expansion routines used to convert the 8-bit frame buffer
+   into the 32-bit streaming texture.
+
+   Each kernel expands 'width' 8-bit pixels from 'src' into 'dst' by
+   looking them up in the 256 entry 'colormap'.  The scaled version also
+   repeats each pixel 'scale' times, for 2 to CONVERT_MAX_SCALE.
+*/
+#define CONVERT_MAX_SCALE	4
+
+typedef void (*ConvertRowFunc)(const Uint8 *src, Uint32 *dst, int width,
+						const Uint32 *colormap);
+typedef void (*ConvertScaledFunc)(const Uint8 *src, Uint32 *dst, int width,
+					const Uint32 *colormap, int scale);
+
+typedef struct ConvertKernel {
+	const char *name;
+	ConvertRowFunc convert;
+	ConvertScaledFunc scaled;
+	SDL_bool (*available)(void);
+} ConvertKernel;
+
+/* The list of kernels, from slowest to fastest, terminated by a NULL name */
+extern const ConvertKernel convert_kernels[];
+
+/* The fastest kernel supported by the CPU we're running on */
+extern const ConvertKernel *BestConvertKernel(void);
+
+/* Convert 'height' rows of 'width' pixels with a kernel, expanding each
+   pixel into a 'scale' by 'scale' block of the destination.
+ */
+extern void ConvertRows(const ConvertKernel *kernel,
+			const Uint8 *src, int srcpitch, const Uint32 *colormap,
+			Uint8 *dst, int dstpitch, int width, int height,
+								int scale);
+
+/* A pool of threads that convert large areas in horizontal bands.
+
+   The calling thread converts bands too, so a pool of N threads has N-1
+   workers, and a pool of one thread converts everything itself.  The
+   workers sleep until Convert() hands out bands, take them one at a time
+   until there are none left, and Convert() returns when they're done.
+*/
+#define CONVERT_MAX_THREADS	16
+#define CONVERT_BAND_ROWS	8	/* The fewest rows in a band */
+
+/* Areas with fewer pixels than this aren't worth splitting */
+#define CONVERT_BAND_THRESHOLD	(64*1024)
+
+class ConvertBands {
+
+public:
+	ConvertBands();
+	~ConvertBands();
+
+	/* Start the workers, by default one thread per CPU core */
+	int Init(int threads = 0);
+	int Threads(void) {
+		return(numthreads);
+	}
+
+	/* Convert an area, the same way as ConvertRows() */
+	void Convert(const ConvertKernel *kernel,
+			const Uint8 *src, int srcpitch, const Uint32 *colormap,
+			Uint8 *dst, int dstpitch, int width, int height,
+							int scale = 1);
+
+private:
+	int numthreads;
+	SDL_Thread *workers[CONVERT_MAX_THREADS];
+	SDL_sem *wakeup;
+	SDL_atomic_t quit;
+
+	/* The conversion being handed out */
+	const ConvertKernel *job_kernel;
+	const Uint8 *job_src;
+	int job_srcpitch;
+	const Uint32 *job_colormap;
+	Uint8 *job_dst;
+	int job_dstpitch;
+	int job_width, job_height;
+	int job_scale;
+	int job_bandrows;
+	int job_bands;
+	SDL_atomic_t untaken;		/* The bands nobody has taken yet */
+	SDL_atomic_t unfinished;	/* The bands not converted yet */
+
+	static int Worker(void *data);
+	void ConvertBand(void);
+};
+
+#endif /* _convert_h */
@@ -0,0 +1,237 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <string.h>
+
+#include "SDL.h"
+#include "dirty.h"
+
+/* Return the index of the lowest set bit in a non-zero word */
+static inline int FirstBit(Uint32 word)
+{
+#if defined(__GNUC__)
+	return(__builtin_ctz(word));
+#else
+	int bit;
+
+	for ( bit = 0; !(word & 1); ++bit ) {
+		word >>= 1;
+	}
+	return(bit);
+#endif
+}
+
+DirtyTiles:: DirtyTiles()
+{
+	width = height = 0;
+	cols = rows = 0;
+	words = 0;
+	bits = NULL;
+	runs = lastruns = NULL;
+	rowmin = 0;
+	rowmax = -1;
+}
+
+DirtyTiles:: ~DirtyTiles()
+{
+	if ( bits )
+		delete[] bits;
+	if ( runs )
+		delete[] runs;
+	if ( lastruns )
+		delete[] lastruns;
+}
+
+void
+DirtyTiles:: Init(int w, int h)
+{
+	width = w;
+	height = h;
+	cols = (width+DIRTY_TILE_SIZE-1)>>DIRTY_TILE_SHIFT;
+	rows = (height+DIRTY_TILE_SIZE-1)>>DIRTY_TILE_SHIFT;
+	words = (cols+31)/32;
+
+	if ( bits )
+		delete[] bits;
+	bits = new Uint32[rows*words];
+	memset(bits, 0, rows*words*sizeof(*bits));
+	rowmin = rows;
+	rowmax = -1;
+
+	/* There can't be more runs on a row than every other tile */
+	if ( runs )
+		delete[] runs;
+	runs = new TileRun[(cols+1)/2];
+	if ( lastruns )
+		delete[] lastruns;
+	lastruns = new TileRun[(cols+1)/2];
+}
+
+void
+DirtyTiles:: Add(const SDL_Rect *area)
+{
+	int x1, y1, x2, y2;
+	int col1, col2, row1, row2;
+	int row, word, first, last;
+	Uint32 mask, *rowbits;
+
+	/* Clip the area to the screen */
+	x1 = SDL_max(area->x, 0);
+	y1 = SDL_max(area->y, 0);
+	x2 = SDL_min(area->x+area->w, width);
+	y2 = SDL_min(area->y+area->h, height);
+	if ( (x1 >= x2) || (y1 >= y2) ) {
+		return;
+	}
+	col1 = x1>>DIRTY_TILE_SHIFT;
+	col2 = (x2-1)>>DIRTY_TILE_SHIFT;
+	row1 = y1>>DIRTY_TILE_SHIFT;
+	row2 = (y2-1)>>DIRTY_TILE_SHIFT;
+
+	/* Set the bits for the range of tiles on each row */
+	rowbits = &bits[row1*words];
+	for ( word = col1/32; word <= col2/32; ++word ) {
+		first = SDL_max(col1-word*32, 0);
+		last = SDL_min(col2-word*32, 31);
+		mask = (0xFFFFFFFF >> (31-(last-first))) << first;
+		for ( row = row1; row <= row2; ++row ) {
+			rowbits[(row-row1)*words+word] |= mask;
+		}
+	}
+	if ( row1 < rowmin ) {
+		rowmin = row1;
+	}
+	if ( row2 > rowmax ) {
+		rowmax = row2;
+	}
+}
+
+int
+DirtyTiles:: Build(SDL_Rect *rects)
+{
+	int numrects;
+	int row, col, numruns, numlastruns, i, j;
+	int shift, skip, len;
+	Uint32 *rowbits, word;
+	TileRun *swap;
+	SDL_Rect *rect;
+
+	numrects = 0;
+	numlastruns = 0;
+	for ( row = rowmin; row <= rowmax; ++row ) {
+		/* Find the runs of marked tiles on this row */
+		rowbits = &bits[row*words];
+		numruns = 0;
+		for ( i = 0; i < words; ++i ) {
+			word = rowbits[i];
+			shift = 0;
+			while ( word ) {
+				/* Skip to the next marked tile */
+				skip = FirstBit(word);
+				word >>= skip;
+				shift += skip;
+				col = i*32 + shift;
+
+				/* Measure the run of marked tiles */
+				if ( ~word ) {
+					len = FirstBit(~word);
+				} else {
+					len = 32;
+				}
+				if ( (numruns > 0) &&
+				     (runs[numruns-1].last == col-1) ) {
+					/* Continued from the last word */
+					runs[numruns-1].last = col+len-1;
+				} else {
+					runs[numruns].first = col;
+					runs[numruns].last = col+len-1;
+					++numruns;
+				}
+				if ( len == 32 ) {
+					break;
+				}
+				word >>= len;
+				shift += len;
+			}
+		}
+
+		/* Extend rectangles from the last row that have the same run,
+		   both lists are sorted so we can walk them together.
+		 */
+		j = 0;
+		for ( i = 0; i < numruns; ++i ) {
+			while ( (j < numlastruns) &&
+				(lastruns[j].first < runs[i].first) ) {
+				++j;
+			}
+			if ( (j < numlastruns) &&
+			     (lastruns[j].first == runs[i].first) &&
+			     (lastruns[j].last == runs[i].last) ) {
+				runs[i].rect = lastruns[j].rect;
+			} else {
+				runs[i].rect = numrects++;
+				rect = &rects[runs[i].rect];
+				rect->x = runs[i].first<<DIRTY_TILE_SHIFT;
+				rect->y = row<<DIRTY_TILE_SHIFT;
+				rect->w = SDL_min((runs[i].last+1)<<DIRTY_TILE_SHIFT,
+							width) - rect->x;
+			}
+			rect = &rects[runs[i].rect];
+			rect->h = SDL_min((row+1)<<DIRTY_TILE_SHIFT, height) -
+								rect->y;
+		}
+
+		swap = lastruns;
+		lastruns = runs;
+		runs = swap;
+		numlastruns = numruns;
+	}
+	return(numrects);
+}
+
+void
+DirtyTiles:: Merge(const DirtyTiles *other)
+{
+	int i, last;
+
+	if ( other->rowmin > other->rowmax ) {
+		return;
+	}
+	last = (other->rowmax+1)*words;
+	for ( i = other->rowmin*words; i < last; ++i ) {
+		bits[i] |= other->bits[i];
+	}
+	if ( other->rowmin < rowmin ) {
+		rowmin = other->rowmin;
+	}
+	if ( other->rowmax > rowmax ) {
+		rowmax = other->rowmax;
+	}
+}
+
+void
+DirtyTiles:: Clear(void)
+{
+	if ( rowmin <= rowmax ) {
+		memset(&bits[rowmin*words], 0,
+			(rowmax-rowmin+1)*words*sizeof(*bits));
+	}
+	rowmin = rows;
+	rowmax = -1;
+}
@@ -0,0 +1,88 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _dirty_h
+#define _dirty_h
+
+/* A dirty area tracker based on a bitmap of fixed size screen tiles:
+
+   Marking an area sets the bits of the tiles it touches, so the cost
+   doesn't depend on how many areas overlap.  When it's time to update
+   the screen, the marked tiles are merged into runs along each tile row,
+   and identical runs on consecutive rows are merged into one rectangle.
+*/
+
+#define DIRTY_TILE_SHIFT	3
+#define DIRTY_TILE_SIZE		(1<<DIRTY_TILE_SHIFT)
+
+class DirtyTiles {
+
+public:
+	DirtyTiles();
+	~DirtyTiles();
+
+	void Init(int width, int height);
+
+	/* Mark an area of the screen as changed */
+	void Add(const SDL_Rect *area);
+
+	/* Fill 'rects' with the changed areas and return how many there are.
+	   There are never more than MaxRects() of them.
+	 */
+	int Build(SDL_Rect *rects);
+	int MaxRects(void) {
+		return(rows*((cols+1)/2));
+	}
+
+	/* Mark all the areas marked in another tracker of the same size */
+	void Merge(const DirtyTiles *other);
+
+	/* Forget all the changed areas */
+	void Clear(void);
+	int Empty(void) {
+		return(rowmin > rowmax);
+	}
+
+	/* Return whether a tile is marked */
+	int IsSet(int col, int row) {
+		return((bits[row*words+(col/32)] >> (col%32)) & 1);
+	}
+	int Cols(void) {
+		return(cols);
+	}
+	int Rows(void) {
+		return(rows);
+	}
+
+private:
+	int width, height;
+	int cols, rows;
+	int words;		/* 32-bit words per tile row */
+	Uint32 *bits;
+	int rowmin, rowmax;	/* The range of rows with any bits set */
+
+	/* Scratch space used to merge runs in Build() */
+	typedef struct {
+		int first, last;
+		int rect;
+	} TileRun;
+	TileRun *runs, *lastruns;
+};
+
+#endif /* _dirty_h */
@@ -20,9 +20,214 @@
 #ifndef _pixel_h
 #define _pixel_h
 
-extern void PutPixel1(Uint8 *screen_loc, SDL_Surface *screen, Uint32 pixel);
-extern void PutPixel2(Uint8 *screen_loc, SDL_Surface *screen, Uint32 pixel);
-extern void PutPixel3(Uint8 *screen_loc, SDL_Surface *screen, Uint32 pixel);
-extern void PutPixel4(Uint8 *screen_loc, SDL_Surface *screen, Uint32 pixel);
+#include <string.h>
+
+/* Drawing primitives specialized on the number of bytes per pixel, so
+   the inner loops write pixels directly instead of calling through a
+   function pointer, and 8-bit fills turn into memset().
+
+   The coordinates passed in must already be clipped to the surface.
+*/
+
+template <int BPP> struct Pixel;
+
+template <> struct Pixel<1> {
+	static inline void Put(Uint8 *loc, const SDL_PixelFormat *, Uint32 pixel) {
+		*loc = (Uint8)pixel;
+	}
+	static inline void Fill(Uint8 *loc, const SDL_PixelFormat *,
+						Uint32 pixel, int count) {
+		memset(loc, (Uint8)pixel, count);
+	}
+};
+template <> struct Pixel<2> {
+	static inline void Put(Uint8 *loc, const SDL_PixelFormat *, Uint32 pixel) {
+		*((Uint16 *)loc) = (Uint16)pixel;
+	}
+	static inline void Fill(Uint8 *loc, const SDL_PixelFormat *,
+						Uint32 pixel, int count) {
+		Uint16 *dst = (Uint16 *)loc;
+
+		while ( count-- ) {
+			*dst++ = (Uint16)pixel;
+		}
+	}
+};
+template <> struct Pixel<3> {
+	static inline void Put(Uint8 *loc, const SDL_PixelFormat *format,
+								Uint32 pixel) {
+		/* Slow, but endian correct */
+		loc[format->Rshift/8] = (Uint8)(pixel>>format->Rshift);
+		loc[format->Gshift/8] = (Uint8)(pixel>>format->Gshift);
+		loc[format->Bshift/8] = (Uint8)(pixel>>format->Bshift);
+	}
+	static inline void Fill(Uint8 *loc, const SDL_PixelFormat *format,
+						Uint32 pixel, int count) {
+		while ( count-- ) {
+			Put(loc, format, pixel);
+			loc += 3;
+		}
+	}
+};
+template <> struct Pixel<4> {
+	static inline void Put(Uint8 *loc, const SDL_PixelFormat *, Uint32 pixel) {
+		*((Uint32 *)loc) = pixel;
+	}
+	static inline void Fill(Uint8 *loc, const SDL_PixelFormat *,
+						Uint32 pixel, int count) {
+		Uint32 *dst = (Uint32 *)loc;
+
+		while ( count-- ) {
+			*dst++ = pixel;
+		}
+	}
+};
+
+template <int BPP>
+static inline Uint8 *PixelAddress(SDL_Surface *surface, int x, int y)
+{
+	return((Uint8 *)surface->pixels + y*surface->pitch + x*BPP);
+}
+
+template <int BPP>
+static inline void DrawPixel(SDL_Surface *surface, int x, int y, Uint32 color)
+{
+	Pixel<BPP>::Put(PixelAddress<BPP>(surface, x, y), surface->format, color);
+}
+
+template <int BPP>
+static inline void DrawHLine(SDL_Surface *surface, int x, int y, int w,
+							Uint32 color)
+{
+	Pixel<BPP>::Fill(PixelAddress<BPP>(surface, x, y), surface->format,
+								color, w);
+}
+
+template <int BPP>
+static inline void DrawVLine(SDL_Surface *surface, int x, int y, int h,
+							Uint32 color)
+{
+	Uint8 *loc;
+
+	loc = PixelAddress<BPP>(surface, x, y);
+	while ( h-- ) {
+		Pixel<BPP>::Put(loc, surface->format, color);
+		loc += surface->pitch;
+	}
+}
+
+/* Integer Bresenham, stepping along the major axis */
+template <int BPP>
+static inline void DrawSlope(SDL_Surface *surface, int x1, int y1,
+					int x2, int y2, Uint32 color)
+{
+	int dx, dy, err;
+	int xstep, ystep, major;
+	Uint8 *loc;
+
+	dx = x2 - x1;
+	dy = y2 - y1;
+	xstep = BPP;
+	ystep = surface->pitch;
+	if ( dx < 0 ) {
+		dx = -dx;
+		xstep = -xstep;
+	}
+	if ( dy < 0 ) {
+		dy = -dy;
+		ystep = -ystep;
+	}
+
+	loc = PixelAddress<BPP>(surface, x1, y1);
+	if ( dx >= dy ) {
+		err = dx / 2;
+		for ( major = dx; major >= 0; --major ) {
+			Pixel<BPP>::Put(loc, surface->format, color);
+			loc += xstep;
+			err -= dy;
+			if ( err < 0 ) {
+				loc += ystep;
+				err += dx;
+			}
+		}
+	} else {
+		err = dy / 2;
+		for ( major = dy; major >= 0; --major ) {
+			Pixel<BPP>::Put(loc, surface->format, color);
+			loc += ystep;
+			err -= dx;
+			if ( err < 0 ) {
+				loc += xstep;
+				err += dy;
+			}
+		}
+	}
+}
+
+template <int BPP>
+static inline void DrawFrame(SDL_Surface *surface, int x, int y, int w, int h,
+							Uint32 color)
+{
+	DrawHLine<BPP>(surface, x, y, w, color);
+	DrawHLine<BPP>(surface, x, y+h-1, w, color);
+	DrawVLine<BPP>(surface, x, y, h, color);
+	DrawVLine<BPP>(surface, x+w-1, y, h, color);
+}
+
+template <int BPP>
+static inline void DrawFill(SDL_Surface *surface, int x, int y, int w, int h,
+							Uint32 color)
+{
+	Uint8 *loc;
+
+	loc = PixelAddress<BPP>(surface, x, y);
+	while ( h-- ) {
+		Pixel<BPP>::Fill(loc, surface->format, color, w);
+		loc += surface->pitch;
+	}
+}
+
+/* Copy 8-bit pixels into an area of a surface, or the colorkey where the
+   mask is clear.  The pixel values are looked up in 'map', if there is one,
+   for a surface that isn't 8-bit.  Each row of source pixels is padded to
+   a multiple of four bytes, and each row of the mask to a multiple of
+   eight pixels.
+ */
+template <int BPP>
+static inline void DrawArtwork(SDL_Surface *surface, int x, int y, int w, int h,
+				const Uint8 *pixels, const Uint8 *mask,
+				const Uint32 *map, Uint32 colorkey, int pad)
+{
+	int i, j;
+	Uint8 m;
+	Uint8 *loc;
+
+	m = 0;
+	for ( i=0; i<h; ++i ) {
+		loc = PixelAddress<BPP>(surface, x, y+i);
+		if ( (BPP == 1) && !mask && !map ) {
+			memcpy(loc, pixels, w);
+			pixels += w;
+		} else {
+			for ( j=0; j<w; ++j ) {
+				if ( mask && ((j%8) == 0) ) {
+					m = *mask++;
+				}
+				if ( mask && !(m & 0x80) ) {
+					Pixel<BPP>::Put(loc, surface->format, colorkey);
+				} else if ( map ) {
+					Pixel<BPP>::Put(loc, surface->format,
+								map[*pixels]);
+				} else {
+					Pixel<BPP>::Put(loc, surface->format, *pixels);
+				}
+				m <<= 1;
+				loc += BPP;
+				pixels += 1;
+			}
+		}
+		pixels += pad;
+	}
+}
 
 #endif /* _pixel_h */
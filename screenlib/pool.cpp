@@ -0,0 +1,147 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <string.h>
+
+#include "SDL.h"
+#include "pool.h"
+
+SurfacePool:: SurfacePool(void (*releasefunc)(SDL_Surface *surface))
+{
+	memset(buckets, 0, sizeof(buckets));
+	clock = 0;
+	release = releasefunc;
+	memset(&stats, 0, sizeof(stats));
+}
+
+SurfacePool:: ~SurfacePool()
+{
+	PoolEntry *entry;
+	int i;
+
+	/* Surfaces still in use are freed here, like the screen's images */
+	for ( i = 0; i < POOL_BUCKETS; ++i ) {
+		while ( buckets[i] ) {
+			entry = buckets[i];
+			buckets[i] = entry->next;
+			Release(entry);
+		}
+	}
+}
+
+SDL_Surface *
+SurfacePool:: Get(int w, int h, int depth)
+{
+	PoolEntry *entry;
+	SDL_Surface *surface;
+	int bucket;
+
+	++clock;
+	bucket = Bucket(w, h);
+	for ( entry = buckets[bucket]; entry; entry = entry->next ) {
+		surface = entry->surface;
+		if ( !entry->in_use && (surface->refcount == 1) &&
+		     (surface->w == w) && (surface->h == h) &&
+		     (surface->format->BitsPerPixel == depth) ) {
+			entry->in_use = 1;
+			entry->last_used = clock;
+			stats.bytes_free -= Bytes(surface);
+			++stats.hits;
+			return(surface);
+		}
+	}
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, depth, 0,0,0,0);
+	if ( surface == NULL ) {
+		return(NULL);
+	}
+	entry = new PoolEntry;
+	entry->surface = surface;
+	entry->in_use = 1;
+	entry->last_used = clock;
+	entry->next = buckets[bucket];
+	buckets[bucket] = entry;
+	stats.bytes_held += Bytes(surface);
+	++stats.misses;
+	return(surface);
+}
+
+int
+SurfacePool:: Put(SDL_Surface *surface)
+{
+	PoolEntry *entry;
+
+	for ( entry = buckets[Bucket(surface->w, surface->h)];
+					entry; entry = entry->next ) {
+		if ( entry->surface == surface ) {
+			if ( entry->in_use ) {
+				entry->in_use = 0;
+				stats.bytes_free += Bytes(surface);
+				if ( stats.bytes_free > POOL_MAX_FREE ) {
+					Trim();
+				}
+			}
+			return(1);
+		}
+	}
+	return(0);
+}
+
+void
+SurfacePool:: Release(PoolEntry *entry)
+{
+	stats.bytes_held -= Bytes(entry->surface);
+	if ( ! entry->in_use ) {
+		stats.bytes_free -= Bytes(entry->surface);
+	}
+	if ( release ) {
+		release(entry->surface);
+	} else {
+		SDL_FreeSurface(entry->surface);
+	}
+	delete entry;
+}
+
+/* Release the least recently used free surfaces until under the limit */
+void
+SurfacePool:: Trim(void)
+{
+	PoolEntry **prev, **oldest, *entry;
+	int i;
+
+	while ( stats.bytes_free > POOL_MAX_FREE ) {
+		oldest = NULL;
+		for ( i = 0; i < POOL_BUCKETS; ++i ) {
+			for ( prev = &buckets[i]; *prev;
+						prev = &(*prev)->next ) {
+				if ( !(*prev)->in_use && (!oldest ||
+				     ((*prev)->last_used < (*oldest)->last_used)) ) {
+					oldest = prev;
+				}
+			}
+		}
+		if ( oldest == NULL ) {
+			break;
+		}
+		entry = *oldest;
+		*oldest = entry->next;
+		Release(entry);
+		++stats.evictions;
+	}
+}
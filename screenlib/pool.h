@@ -0,0 +1,88 @@
+/*
+    SCREENLIB:  A framebuffer library based on the SDL library
+    Copyright (C) 1997-2021 Sam Lantinga <slouken@libsdl.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _pool_h
+#define _pool_h
+
+/* A pool of surfaces for images that are made and thrown away all the time,
+   like text and the screen areas saved under dialogs:
+
+   Get() hands out a surface of the requested size and depth, reusing one
+   given back with Put() if there is one.  The pool keeps its own reference
+   to each surface, and a surface given back while a queued blit still
+   references it isn't reused until the blit is done and only the pool's
+   reference is left.  Free surfaces are kept up to POOL_MAX_FREE bytes,
+   the least recently used are released first.
+*/
+
+#define POOL_BUCKETS	32		/* Hash buckets, by surface size */
+#define POOL_MAX_FREE	(1024*1024)	/* Bytes of free surfaces kept */
+
+typedef struct {
+	Uint32 hits;		/* Surfaces reused from the pool */
+	Uint32 misses;		/* Surfaces allocated */
+	Uint32 evictions;	/* Free surfaces released to stay in the limit */
+	Uint32 bytes_held;	/* Pixels of all the surfaces in the pool */
+	Uint32 bytes_free;	/* Pixels of the surfaces not in use */
+} SurfacePoolStats;
+
+class SurfacePool {
+
+public:
+	/* 'release' frees a surface the pool is done with, by default
+	   SDL_FreeSurface()
+	 */
+	SurfacePool(void (*release)(SDL_Surface *surface) = NULL);
+	~SurfacePool();
+
+	/* Return a surface, with the palette and pixels left by its last
+	   user, or NULL if it couldn't be allocated.
+	 */
+	SDL_Surface *Get(int w, int h, int depth);
+
+	/* Give back a surface from Get(), returning 0 if it isn't one */
+	int Put(SDL_Surface *surface);
+
+	const SurfacePoolStats *Stats(void) {
+		return(&stats);
+	}
+
+private:
+	typedef struct PoolEntry {
+		SDL_Surface *surface;
+		int in_use;
+		Uint32 last_used;
+		struct PoolEntry *next;
+	} PoolEntry;
+	PoolEntry *buckets[POOL_BUCKETS];
+	Uint32 clock;			/* Counts Get() calls, for last_used */
+	void (*release)(SDL_Surface *surface);
+	SurfacePoolStats stats;
+
+	static int Bucket(int w, int h) {
+		return((w*31 + h) % POOL_BUCKETS);
+	}
+	static Uint32 Bytes(SDL_Surface *surface) {
+		return(surface->pitch * surface->h);
+	}
+	void Release(PoolEntry *entry);
+	void Trim(void);
+};
+
+#endif /* _pool_h */
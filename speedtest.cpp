@@ -0,0 +1,2089 @@
+
+/* Graphics speed tests, run with the -speedtest command line option */
+
+#include "Maelstrom_Globals.h"
+#include "load.h"
+#include "colortable.h"
+#include "convert.h"
+#include "dirty.h"
+#include "capture.h"
+#include "netplay.h"
+#include "object.h"
+#include "player.h"
+#include "globals.h"
+#include "objects.h"
+
+
+/* ----------------------------------------------------------------- */
+/* -- What the tests share                                           */
+
+#define NANOSECONDS	1000000000.0
+#define MICROSECONDS	1000000.0
+#define MILLISECONDS	1000.0
+
+/* The time taken by a difference of performance counter readings, in the
+   given units of a second, for each of the reps it covers.
+ */
+static double Elapsed(Uint64 ticks, double units, int reps)
+{
+	return(((double)ticks*units/SDL_GetPerformanceFrequency())/reps);
+}
+
+/* Fill a frame with noise, so there is nothing to predict */
+static void NoiseFrame(Uint8 *pixels, int len)
+{
+	Uint32 seed;
+	int i;
+
+	seed = 1;
+	for ( i=0; i<len; ++i ) {
+		seed = (seed * 1103515245) + 12345;
+		pixels[i] = (Uint8)(seed >> 16);
+	}
+}
+
+/* A colormap that turns every pixel value into a different color */
+static void TestColormap(Uint32 *colormap)
+{
+	int i;
+
+	for ( i=0; i<256; ++i ) {
+		colormap[i] = screen->MapRGB(i, 255-i, i/2) | 0xFF000000;
+	}
+}
+
+
+/* ----------------------------------------------------------------- */
+/* -- Time a full rotation of the ship                               */
+static void SpriteCycles(const char *mode, Uint32 options,
+					int updates, int framed)
+{
+	const int test_reps = 100;	/* How many full cycles to run */
+
+	const FrameBufStats *stats;
+	Uint32 then, now, saved_options;
+	int i, j, frame, x=((640/2)-16), y=((480/2)-16), onscreen=0;
+
+	saved_options = screen->Options();
+	if ( screen->SetOptions(options) < 0 ) {
+		error("Couldn't change the screen options: %s\n",
+							screen->Error());
+		return;
+	}
+	screen->Clear();
+	screen->Update();
+	screen->ResetStats();
+	then = SDL_GetTicks();
+	for ( i=0; i<test_reps; ++i ) {
+		for ( frame=0; frame<SHIP_FRAMES; ++frame ) {
+			if ( framed ) {
+				screen->BeginFrame();
+			}
+			if ( onscreen ) {
+				screen->Clear(x, y, 32, 32);
+			} else {
+				onscreen = 1;
+			}
+			screen->QueueBlit(x, y, &gPlayerShip->sprite[frame]);
+			/* RunFrame() updates after the sprites, the player
+			   dots and again before waiting for the next frame.
+			 */
+			for ( j=0; j<updates; ++j ) {
+				screen->Update();
+			}
+			if ( framed ) {
+				screen->EndFrame();
+			}
+		}
+	}
+	now = SDL_GetTicks();
+	stats = screen->Stats();
+	mesg("Graphics speed test (%s) took %d microseconds per cycle.\r\n",
+					mode, ((now-then)/test_reps));
+	mesg("\t%d presents, %d full, %d pixels converted per present\r\n",
+		stats->presents, stats->full_updates,
+		stats->presents ? (int)(stats->converted/stats->presents) : 0);
+	if ( framed ) {
+		mesg("\t%d frames, %d extra presents\r\n",
+				stats->frames, stats->extra_presents);
+	}
+	if ( options & FRAMEBUF_RENDERTHREAD ) {
+		mesg("\t%d frames dropped, %d frames late\r\n",
+				stats->dropped_frames, stats->late_frames);
+	}
+	if ( screen->SetOptions(saved_options) < 0 ) {
+		error("Couldn't change the screen options: %s\n",
+							screen->Error());
+	}
+}
+static void SpriteTest(void)
+{
+	Uint32 options = (screen->Options() & ~FRAMEBUF_RENDERTHREAD);
+
+	SpriteCycles("full update", options & ~FRAMEBUF_DIRTYUPDATE, 1, 0);
+	SpriteCycles("dirty update", options | FRAMEBUF_DIRTYUPDATE, 1, 0);
+	SpriteCycles("3 updates per frame",
+				options | FRAMEBUF_DIRTYUPDATE, 3, 0);
+	SpriteCycles("3 updates, one present per frame",
+				options | FRAMEBUF_DIRTYUPDATE, 3, 1);
+	SpriteCycles("3 updates, converted by a render thread",
+		options | FRAMEBUF_DIRTYUPDATE | FRAMEBUF_RENDERTHREAD, 3, 1);
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the atlas span blitter against separate sprite surfaces   */
+
+/* Copy a sprite frame out of the atlas into a surface of its own,
+   either loaded the way sprites used to be, or as an RLE accelerated
+   colorkey surface for SDL to blit.
+ */
+static SDL_Surface *SeparateFrame(const Blit *blit, int index, int rle)
+{
+	SDL_Surface *image;
+	Uint8 *pixels, *mask, *src;
+	int used[256];
+	const AtlasFrame *frame;
+	int i, x, y, w, h, key;
+
+	frame = &blit->sprite[index];
+	w = frame->area.w;
+	h = frame->area.h;
+	pixels = new Uint8[w*h];
+	mask = new Uint8[((w+7)/8)*h];
+	memset(mask, 0, ((w+7)/8)*h);
+	memset(used, 0, sizeof(used));
+	for ( y=0; y<h; ++y ) {
+		src = (Uint8 *)frame->page->pixels +
+			(frame->area.y+y)*frame->page->pitch + frame->area.x;
+		for ( x=0; x<w; ++x ) {
+			i = y*w+x;
+			pixels[i] = src[x];
+			if ( MaskPixel(blit, index, x, y) ) {
+				mask[y*((w+7)/8)+(x/8)] |= (0x80 >> (x%8));
+				++used[src[x]];
+			}
+		}
+	}
+
+	if ( rle ) {
+		for ( key=0; key<255 && used[key]; ++key ) {
+			/* Keep looking */;
+		}
+		image = SDL_CreateRGBSurface(0, w, h, 8, 0, 0, 0, 0);
+		if ( image ) {
+			for ( y=0; y<h; ++y ) {
+				for ( x=0; x<w; ++x ) {
+					i = y*w+x;
+					((Uint8 *)image->pixels)[y*image->pitch+x] =
+						MaskPixel(blit, index, x, y) ?
+							pixels[i] : key;
+				}
+			}
+			SDL_SetColorKey(image, SDL_RLEACCEL, key);
+		}
+	} else {
+		/* Sprite frames are a multiple of four pixels wide */
+		image = screen->LoadImage(w, h, pixels, mask);
+	}
+	delete[] pixels;
+	delete[] mask;
+	return(image);
+}
+
+static void BlitTest(void)
+{
+	const int test_reps = 200;	/* How many times to blit every frame */
+
+	BlitPtr blits[] = {
+		gRock1R, gRock2R, gRock3R, gPlayerShip, gExplosion, gShrapnel1
+	};
+	const AtlasFrame **frames;
+	SDL_Surface **separate, **copies, *target;
+	SDL_Rect *srcrects, *dstrects;
+	Uint32 seed;
+	Uint64 then, atlas_time, separate_time, sdl_time;
+	int i, j, rep, numframes, numblits, failed;
+
+	target = SDL_CreateRGBSurface(0, screen->Width(), screen->Height(),
+								8, 0, 0, 0, 0);
+	if ( target == NULL ) {
+		error("Couldn't create blit target: %s\n", SDL_GetError());
+		return;
+	}
+	numframes = 0;
+	for ( i=0; i<(int)SDL_arraysize(blits); ++i ) {
+		numframes += blits[i]->numFrames;
+	}
+	frames = new const AtlasFrame *[numframes];
+	separate = new SDL_Surface *[numframes];
+	copies = new SDL_Surface *[numframes];
+	srcrects = new SDL_Rect[numframes];
+	dstrects = new SDL_Rect[numframes];
+
+	/* Make the separate copies of the sprites */
+	seed = 1;
+	numframes = 0;
+	failed = 0;
+	for ( i=0; !failed && i<(int)SDL_arraysize(blits); ++i ) {
+		for ( j=0; j<blits[i]->numFrames; ++j ) {
+			frames[numframes] = &blits[i]->sprite[j];
+			separate[numframes] = SeparateFrame(blits[i], j, 0);
+			copies[numframes] = SeparateFrame(blits[i], j, 1);
+			if ( !separate[numframes] || !copies[numframes] ) {
+				error("Couldn't copy sprite: %s\n",
+							SDL_GetError());
+				if ( separate[numframes] ) {
+					screen->FreeImage(separate[numframes]);
+				}
+				if ( copies[numframes] ) {
+					SDL_FreeSurface(copies[numframes]);
+				}
+				failed = 1;
+				break;
+			}
+			srcrects[numframes].x = 0;
+			srcrects[numframes].y = 0;
+			srcrects[numframes].w = frames[numframes]->area.w;
+			srcrects[numframes].h = frames[numframes]->area.h;
+			seed = (seed * 1103515245) + 12345;
+			dstrects[numframes].x = (seed >> 8) %
+				(screen->Width()-srcrects[numframes].w);
+			dstrects[numframes].y = (seed >> 4) %
+				(screen->Height()-srcrects[numframes].h);
+			dstrects[numframes].w = srcrects[numframes].w;
+			dstrects[numframes].h = srcrects[numframes].h;
+			++numframes;
+		}
+	}
+	if ( failed ) {
+		goto done;
+	}
+	numblits = numframes*test_reps;
+
+	then = SDL_GetPerformanceCounter();
+	for ( rep=0; rep<test_reps; ++rep ) {
+		for ( i=0; i<numframes; ++i ) {
+			screen->QueueBlit(dstrects[i].x, dstrects[i].y,
+							frames[i], NOCLIP);
+		}
+		screen->PerformBlits();
+	}
+	atlas_time = SDL_GetPerformanceCounter()-then;
+
+	then = SDL_GetPerformanceCounter();
+	for ( rep=0; rep<test_reps; ++rep ) {
+		for ( i=0; i<numframes; ++i ) {
+			screen->QueueBlit(dstrects[i].x, dstrects[i].y,
+							separate[i], NOCLIP);
+		}
+		screen->PerformBlits();
+	}
+	separate_time = SDL_GetPerformanceCounter()-then;
+
+	then = SDL_GetPerformanceCounter();
+	for ( rep=0; rep<test_reps; ++rep ) {
+		for ( i=0; i<numframes; ++i ) {
+			SDL_Rect dstrect = dstrects[i];
+			SDL_LowerBlit(copies[i], &srcrects[i],
+						target, &dstrect);
+		}
+	}
+	sdl_time = SDL_GetPerformanceCounter()-then;
+
+	mesg("Sprite blits of %d frames, %d times each:\r\n",
+						numframes, test_reps);
+	mesg("\tSDL RLE blit:        %6.1f ns per blit\r\n",
+			Elapsed(sdl_time, NANOSECONDS, numblits));
+	mesg("\tspan blit, surfaces: %6.1f ns per blit, %4.2fx\r\n",
+			Elapsed(separate_time, NANOSECONDS, numblits),
+			(double)sdl_time/separate_time);
+	mesg("\tspan blit, atlas:    %6.1f ns per blit, %4.2fx\r\n",
+			Elapsed(atlas_time, NANOSECONDS, numblits),
+			(double)sdl_time/atlas_time);
+
+	/* Clean up */
+done:
+	screen->Clear();
+	screen->Update();
+	for ( i=0; i<numframes; ++i ) {
+		screen->FreeImage(separate[i]);
+		SDL_FreeSurface(copies[i]);
+	}
+	SDL_FreeSurface(target);
+	delete[] frames;
+	delete[] separate;
+	delete[] copies;
+	delete[] srcrects;
+	delete[] dstrects;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the drawing primitives specialized by pixel size          */
+
+static Uint32 ourGrey, ourWhite, ourBlack;
+
+/* What DoStatus() draws when everything on the status bar changes */
+static void DrawStatusBar(int frame)
+{
+	int i, fact;
+
+	screen->DrawLine(0, gStatusLine, SCREEN_WIDTH-1, gStatusLine, ourWhite);
+	screen->FillRect(0, 0, SCREEN_WIDTH, 12, ourBlack);
+	screen->FillRect(518, gStatusLine+4, 4, 8, ourGrey);
+	fact = frame % (SHIELD_WIDTH-1);
+	screen->DrawRect(152, gStatusLine+4, SHIELD_WIDTH, 8, ourWhite);
+	screen->FillRect(152+1, gStatusLine+4+1, fact, 6, ourGrey);
+	screen->FillRect(152+1+fact, gStatusLine+4+1,
+					SHIELD_WIDTH-2-fact, 6, ourBlack);
+	for ( i=0; i<5; ++i ) {
+		screen->FillRect(438+i*16, gStatusLine+4, 8, 8, ourBlack);
+	}
+	screen->FillRect(45, gStatusLine+1, 60, 12, ourBlack);
+	screen->FillRect(255, gStatusLine+1, 30, 12, ourBlack);
+	screen->FillRect(319, gStatusLine+1, 30, 12, ourBlack);
+	screen->FillRect(384, gStatusLine+1, 60, 12, ourBlack);
+}
+
+/* The frame Maclike_Dialog::Show() draws around a dialog */
+static void DrawDialog(int)
+{
+	const int X = 120, Y = 100, Width = 400, Height = 240;
+	int maxX = X+Width-4, maxY = Y+Height-4;
+
+	screen->DrawLine(X, Y, maxX, Y, ourWhite);
+	screen->DrawLine(X, Y, X, maxY, ourWhite);
+	screen->DrawLine(X, maxY, maxX, maxY, ourGrey);
+	screen->DrawLine(maxX, Y, maxX, maxY, ourGrey);
+	screen->DrawRect(X+1, Y+1, Width-2, Height-2, ourGrey);
+	screen->DrawLine(X+2, Y+2, maxX-2, Y+2, ourGrey);
+	screen->DrawLine(X+2, Y+2, X+2, maxY-2, ourGrey);
+	screen->DrawLine(X+3, maxY-2, maxX-2, maxY-2, ourWhite);
+	screen->DrawLine(maxX-2, Y+3, maxX-2, maxY-2, ourWhite);
+	screen->DrawRect(X+3, Y+3, Width-6, Height-6, ourBlack);
+	screen->FillRect(X+4, Y+4, Width-8, Height-8, ourWhite);
+}
+
+/* A fan of sloped lines, which the game only draws in a few places */
+static void DrawSlopes(int)
+{
+	int i;
+
+	for ( i=0; i<SCREEN_WIDTH; i += 16 ) {
+		screen->DrawLine(SCREEN_WIDTH/2, 0, i, gStatusLine-1, ourWhite);
+	}
+	for ( i=0; i<gStatusLine; i += 16 ) {
+		screen->DrawLine(0, gStatusLine/2, SCREEN_WIDTH-1, i, ourGrey);
+	}
+}
+
+static void DrawTest(void)
+{
+	const int test_reps = 2000;	/* How many times to draw each one */
+
+	/* The microseconds each took drawn with the PutPixel function
+	   pointer, and with the specialized primitives that replaced it,
+	   recorded together on one machine when they were replaced.
+	 */
+	static const struct {
+		const char *name;
+		void (*draw)(int frame);
+		double before_us, after_us;
+	} workloads[] = {
+		{ "Status bar",	DrawStatusBar,	18.9,	0.66 },
+		{ "Dialog",	DrawDialog,	172.0,	7.7 },
+		{ "Slopes",	DrawSlopes,	67.0,	50.0 },
+	};
+	Uint64 then;
+	unsigned int i;
+	int rep;
+
+	ourGrey = screen->MapRGB(30000>>8, 30000>>8, 0xFF);
+	ourWhite = screen->MapRGB(0xFF, 0xFF, 0xFF);
+	ourBlack = screen->MapRGB(0x00, 0x00, 0x00);
+
+	mesg("Drawing primitives, now and as recorded before vs. after:\r\n");
+	screen->Clear();
+	screen->Update();
+	for ( i=0; i<SDL_arraysize(workloads); ++i ) {
+		then = SDL_GetPerformanceCounter();
+		for ( rep=0; rep<test_reps; ++rep ) {
+			workloads[i].draw(rep);
+		}
+		mesg("\t%-12s %8.2f us, recorded %8.2f us, %8.2f us, %5.2fx\r\n",
+			workloads[i].name,
+			Elapsed(SDL_GetPerformanceCounter()-then,
+						MICROSECONDS, test_reps),
+			workloads[i].before_us, workloads[i].after_us,
+			workloads[i].before_us/workloads[i].after_us);
+	}
+	screen->Clear();
+	screen->Update();
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the palette expansion kernels against the plain C loop    */
+static void ConvertTest(void)
+{
+	const int test_reps = 200;	/* How many full frames to convert */
+
+	const ConvertKernel *kernel;
+	int i, w, h, row, scale, pitch;
+	Uint8 *pixels;
+	Uint32 *output, *expected, colormap[256];
+	Uint64 then, now;
+	double us, pixels_per_ns, scalar_rate;
+
+	w = screen->Width();
+	h = screen->Height();
+	pixels = new Uint8[w*h];
+	output = new Uint32[w*h];
+	expected = new Uint32[w*h];
+	NoiseFrame(pixels, w*h);
+	TestColormap(colormap);
+	convert_kernels[0].convert(pixels, expected, w*h, colormap);
+
+	mesg("Palette expansion of a %dx%d frame:\r\n", w, h);
+	scalar_rate = 0.0;
+	for ( kernel = convert_kernels; kernel->name; ++kernel ) {
+		if ( ! kernel->available() ) {
+			mesg("\t%-8s not supported on this CPU\r\n", kernel->name);
+			continue;
+		}
+		memset(output, 0, w*h*sizeof(*output));
+		then = SDL_GetPerformanceCounter();
+		for ( i=0; i<test_reps; ++i ) {
+			for ( row=0; row<h; ++row ) {
+				kernel->convert(&pixels[row*w], &output[row*w],
+								w, colormap);
+			}
+		}
+		now = SDL_GetPerformanceCounter();
+		if ( memcmp(output, expected, w*h*sizeof(*output)) != 0 ) {
+			error("\t%-8s produced incorrect output!\r\n",
+							kernel->name);
+			continue;
+		}
+		us = Elapsed(now-then, MICROSECONDS, test_reps);
+		pixels_per_ns = ((double)w*h) / (us*1000.0);
+		if ( scalar_rate == 0.0 ) {
+			scalar_rate = pixels_per_ns;
+		}
+		mesg("\t%-8s %6.3f pixels/ns, %7.1f us/frame, %4.2fx\r\n",
+			kernel->name, pixels_per_ns, us,
+						pixels_per_ns/scalar_rate);
+	}
+	mesg("\tUpdateScreen() uses %s\r\n", BestConvertKernel()->name);
+	delete[] output;
+	delete[] expected;
+
+	/* Expand the same frame into a texture scaled up in the same pass */
+	output = new Uint32[w*h*CONVERT_MAX_SCALE*CONVERT_MAX_SCALE];
+	expected = new Uint32[w*h*CONVERT_MAX_SCALE*CONVERT_MAX_SCALE];
+	for ( scale=2; scale<=CONVERT_MAX_SCALE; ++scale ) {
+		pitch = w*scale*sizeof(*output);
+		ConvertRows(&convert_kernels[0], pixels, w, colormap,
+				(Uint8 *)expected, pitch, w, h, scale);
+
+		mesg("Palette expansion of a %dx%d frame scaled %dx:\r\n",
+								w, h, scale);
+		for ( kernel = convert_kernels; kernel->name; ++kernel ) {
+			if ( ! kernel->available() ) {
+				continue;
+			}
+			memset(output, 0, pitch*h*scale);
+			then = SDL_GetPerformanceCounter();
+			for ( i=0; i<test_reps; ++i ) {
+				ConvertRows(kernel, pixels, w, colormap,
+					(Uint8 *)output, pitch, w, h, scale);
+			}
+			now = SDL_GetPerformanceCounter();
+			if ( memcmp(output, expected, pitch*h*scale) != 0 ) {
+				error("\t%-8s produced incorrect output!\r\n",
+							kernel->name);
+				continue;
+			}
+			mesg("\t%-8s %7.1f us/frame\r\n", kernel->name,
+				Elapsed(now-then, MICROSECONDS, test_reps));
+		}
+	}
+
+	delete[] pixels;
+	delete[] output;
+	delete[] expected;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time full frame conversion split into bands across threads     */
+
+static void BandsTest(void)
+{
+	const int test_reps = 100;	/* How many full frames to convert */
+	const int scales[] = { 1, 2, 3 };
+
+	const ConvertKernel *kernel;
+	ConvertBands *bands;
+	int i, s, w, h, threads, maxthreads;
+	Uint8 *pixels;
+	Uint32 *output, *expected, colormap[256];
+	Uint64 then, now;
+	double us, single_us;
+
+	kernel = BestConvertKernel();
+	TestColormap(colormap);
+	maxthreads = SDL_min(SDL_GetCPUCount(), CONVERT_MAX_THREADS);
+
+	/* Larger logical sizes are the screen scaled up */
+	for ( s=0; s<(int)SDL_arraysize(scales); ++s ) {
+		w = screen->Width()*scales[s];
+		h = screen->Height()*scales[s];
+		pixels = new Uint8[w*h];
+		output = new Uint32[w*h];
+		expected = new Uint32[w*h];
+		NoiseFrame(pixels, w*h);
+		kernel->convert(pixels, expected, w*h, colormap);
+
+		mesg("Banded %s expansion of a %dx%d frame:\r\n",
+				kernel->name, w, h);
+		single_us = 0.0;
+		for ( threads=1; threads<=maxthreads; ++threads ) {
+			bands = new ConvertBands;
+			if ( bands->Init(threads) < 0 ) {
+				error("\tCouldn't start %d threads\r\n", threads);
+				delete bands;
+				break;
+			}
+			memset(output, 0, w*h*sizeof(*output));
+			then = SDL_GetPerformanceCounter();
+			for ( i=0; i<test_reps; ++i ) {
+				bands->Convert(kernel, pixels, w, colormap,
+					(Uint8 *)output, w*sizeof(*output), w, h);
+			}
+			now = SDL_GetPerformanceCounter();
+			delete bands;
+			if ( memcmp(output, expected, w*h*sizeof(*output)) ) {
+				error("\t%2d threads produced incorrect output!\r\n",
+								threads);
+				continue;
+			}
+			us = Elapsed(now-then, MICROSECONDS, test_reps);
+			if ( single_us == 0.0 ) {
+				single_us = us;
+			}
+			mesg("\t%2d threads %8.1f us/frame, %4.2fx\r\n",
+					threads, us, single_us/us);
+		}
+		delete[] pixels;
+		delete[] output;
+		delete[] expected;
+	}
+	mesg("\tUpdateScreen() splits areas of %d pixels or more\r\n",
+						CONVERT_BAND_THRESHOLD);
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Compare the dirty tile tracker to the old center-hash merging  */
+
+/* Return the number of on-screen pixels covered by the rectangles,
+   counting overlapping areas as many times as they are covered.
+ */
+static int CoveredPixels(const SDL_Rect *rects, int numrects, int w, int h)
+{
+	SDL_Rect screen_area, area;
+	int i, pixels;
+
+	screen_area.x = 0;
+	screen_area.y = 0;
+	screen_area.w = w;
+	screen_area.h = h;
+	pixels = 0;
+	for ( i=0; i<numrects; ++i ) {
+		if ( SDL_IntersectRect(&rects[i], &screen_area, &area) ) {
+			pixels += area.w*area.h;
+		}
+	}
+	return(pixels);
+}
+
+/* Return the number of distinct on-screen pixels covered */
+static int ChangedPixels(const SDL_Rect *rects, int numrects, int w, int h,
+							Uint8 *coverage)
+{
+	int i, x, y, x1, y1, x2, y2, pixels;
+
+	pixels = 0;
+	for ( i=0; i<numrects; ++i ) {
+		x1 = SDL_max(rects[i].x, 0);
+		y1 = SDL_max(rects[i].y, 0);
+		x2 = SDL_min(rects[i].x+rects[i].w, w);
+		y2 = SDL_min(rects[i].y+rects[i].h, h);
+		for ( y=y1; y<y2; ++y ) {
+			for ( x=x1; x<x2; ++x ) {
+				if ( ! coverage[y*w+x] ) {
+					coverage[y*w+x] = 1;
+					++pixels;
+				}
+			}
+		}
+	}
+	for ( i=0; i<numrects; ++i ) {
+		x1 = SDL_max(rects[i].x, 0);
+		y1 = SDL_max(rects[i].y, 0);
+		x2 = SDL_min(rects[i].x+rects[i].w, w);
+		y2 = SDL_min(rects[i].y+rects[i].h, h);
+		for ( y=y1; y<y2; ++y ) {
+			if ( x2 > x1 ) {
+				memset(&coverage[y*w+x1], 0, x2-x1);
+			}
+		}
+	}
+	return(pixels);
+}
+
+/* What the center-hash merging that FrameBuf::AddDirtyRect() used to do
+   made of the same sprites on a 640x480 screen, recorded when the tile
+   tracker replaced it.  The sprites move the same way every time, so the
+   counts don't depend on the machine.
+ */
+typedef struct {
+	int rects;		/* All the rectangles it sent */
+	int pixels;		/* ... and the pixels they covered */
+} DirtyBaseline;
+
+static void DirtyLoad(const char *name, int numsprites, int size, int frames,
+					const DirtyBaseline *baseline)
+{
+	DirtyTiles tiles;
+	SDL_Rect *rects, *tilerects;
+	Uint8 *coverage;
+	int *xpos, *ypos, *xvel, *yvel;
+	int i, frame, numrects, w, h;
+	int tile_rects, tile_pixels, changed;
+	Uint32 seed;
+	Uint64 tile_time, then;
+
+	w = screen->Width();
+	h = screen->Height();
+	tiles.Init(w, h);
+	rects = new SDL_Rect[numsprites*2];
+	tilerects = new SDL_Rect[tiles.MaxRects()];
+	coverage = new Uint8[w*h];
+	memset(coverage, 0, w*h);
+	xpos = new int[numsprites];
+	ypos = new int[numsprites];
+	xvel = new int[numsprites];
+	yvel = new int[numsprites];
+
+	seed = 1;
+	for ( i=0; i<numsprites; ++i ) {
+		seed = (seed * 1103515245) + 12345;
+		xpos[i] = (seed >> 8) % (w-size);
+		ypos[i] = (seed >> 4) % (h-size);
+		xvel[i] = (int)((seed >> 16) % 9) - 4;
+		yvel[i] = (int)((seed >> 20) % 9) - 4;
+	}
+
+	tile_rects = tile_pixels = 0;
+	changed = 0;
+	tile_time = 0;
+	for ( frame=0; frame<frames; ++frame ) {
+		/* Erase the old position and draw the new one */
+		numrects = 0;
+		for ( i=0; i<numsprites; ++i ) {
+			rects[numrects].x = xpos[i];
+			rects[numrects].y = ypos[i];
+			rects[numrects].w = size;
+			rects[numrects].h = size;
+			++numrects;
+			xpos[i] += xvel[i];
+			if ( (xpos[i] < 0) || (xpos[i] > (w-size)) ) {
+				xvel[i] = -xvel[i];
+				xpos[i] += 2*xvel[i];
+			}
+			ypos[i] += yvel[i];
+			if ( (ypos[i] < 0) || (ypos[i] > (h-size)) ) {
+				yvel[i] = -yvel[i];
+				ypos[i] += 2*yvel[i];
+			}
+			rects[numrects].x = xpos[i];
+			rects[numrects].y = ypos[i];
+			rects[numrects].w = size;
+			rects[numrects].h = size;
+			++numrects;
+		}
+
+		then = SDL_GetPerformanceCounter();
+		for ( i=0; i<numrects; ++i ) {
+			tiles.Add(&rects[i]);
+		}
+		i = tiles.Build(tilerects);
+		tiles.Clear();
+		tile_time += SDL_GetPerformanceCounter()-then;
+		tile_rects += i;
+		tile_pixels += CoveredPixels(tilerects, i, w, h);
+
+		changed += ChangedPixels(rects, numrects, w, h, coverage);
+	}
+
+	mesg("%s: %d sprites of %dx%d, %d pixels changed per frame\r\n",
+				name, numsprites, size, size, changed/frames);
+	if ( (w == 640) && (h == 480) ) {
+		mesg("\tcenter hash: %5d rects, %4.2fx overdraw, as recorded\r\n",
+			baseline->rects/frames,
+			(double)baseline->pixels/changed);
+	}
+	mesg("\tdirty tiles: %5d rects, %4.2fx overdraw, %6.0f ns per frame\r\n",
+		tile_rects/frames, (double)tile_pixels/changed,
+		Elapsed(tile_time, NANOSECONDS, frames));
+
+	delete[] rects;
+	delete[] tilerects;
+	delete[] coverage;
+	delete[] xpos;
+	delete[] ypos;
+	delete[] xvel;
+	delete[] yvel;
+}
+static void DirtyTest(void)
+{
+	static const DirtyBaseline normal = { 25012, 27850318 };
+	static const DirtyBaseline heavy = { 117963, 132817872 };
+	static const DirtyBaseline storm = { 104866, 23381409 };
+
+	DirtyLoad("Normal play", 20, 32, 1000, &normal);
+	DirtyLoad("Heavy play", 100, 32, 1000, &heavy);
+	DirtyLoad("Blit storm", 2000, 8, 100, &storm);
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the frame capture and decode what it wrote                */
+
+static inline Uint16 Get16(const Uint8 *in)
+{
+	return((Uint16)(in[0] | (in[1] << 8)));
+}
+
+/* Decode a capture written by FrameCapture, see capture.h, comparing each
+   frame with the source frame it was queued from.  This returns the number
+   of frames that differ, or -1 if the file doesn't decode.
+ */
+static int DecodeCapture(const char *file, Uint8 **sources, int numsources,
+							int *decoded)
+{
+	FILE *fp;
+	Uint8 *data, *in, *end, *pixels, *dst;
+	long size;
+	int w, h, flags, numrects, x, y, rw, rh, i, row, n, left, differ;
+
+	*decoded = 0;
+	fp = fopen(file, "rb");
+	if ( fp == NULL ) {
+		return(-1);
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data = new Uint8[size];
+	if ( (size < 12) || (fread(data, size, 1, fp) != 1) ||
+	     memcmp(data, CAPTURE_MAGIC, 8) ) {
+		delete[] data;
+		fclose(fp);
+		return(-1);
+	}
+	fclose(fp);
+
+	w = Get16(&data[8]);
+	h = Get16(&data[10]);
+	pixels = new Uint8[w*h];
+	memset(pixels, 0, w*h);
+	in = &data[12];
+	end = &data[size];
+	differ = 0;
+	while ( in < end ) {
+		/* The time and flags, the colormap isn't checked */
+		if ( (end-in) < 5 ) {
+			break;
+		}
+		flags = in[4];
+		in += 5;
+		if ( flags & CAPTURE_COLORMAP ) {
+			in += 256*4;
+		}
+		if ( (end-in) < 2 ) {
+			break;
+		}
+		numrects = Get16(in);
+		in += 2;
+		for ( i = 0; i < numrects; ++i ) {
+			if ( (end-in) < 8 ) {
+				break;
+			}
+			x = Get16(&in[0]);
+			y = Get16(&in[2]);
+			rw = Get16(&in[4]);
+			rh = Get16(&in[6]);
+			in += 8;
+			if ( ((x+rw) > w) || ((y+rh) > h) ) {
+				break;
+			}
+			/* Each row is runs covering exactly its width */
+			for ( row = 0; row < rh; ++row ) {
+				dst = pixels + (y+row)*w + x;
+				for ( left = rw; (left > 0) && (in < end); ) {
+					n = (*in & ~0xC0) + 1;
+					if ( n > left ) {
+						break;
+					}
+					switch (*in++ & 0xC0) {
+					    case CAPTURE_SKIP:
+						break;
+					    case CAPTURE_COPY:
+						if ( (end-in) < n ) {
+							n = left+1;
+							break;
+						}
+						memcpy(dst, in, n);
+						in += n;
+						break;
+					    case CAPTURE_FILL:
+						if ( in == end ) {
+							n = left+1;
+							break;
+						}
+						memset(dst, *in++, n);
+						break;
+					    default:
+						n = left+1;
+						break;
+					}
+					if ( n > left ) {
+						break;
+					}
+					dst += n;
+					left -= n;
+				}
+				if ( left ) {
+					break;
+				}
+			}
+			if ( row < rh ) {
+				break;
+			}
+		}
+		if ( i < numrects ) {
+			break;
+		}
+		if ( (*decoded >= numsources) ||
+		     memcmp(pixels, sources[*decoded], w*h) ) {
+			++differ;
+		}
+		++*decoded;
+	}
+	delete[] pixels;
+	delete[] data;
+	if ( in < end ) {
+		return(-1);
+	}
+	return(differ);
+}
+
+static void CaptureTest(void)
+{
+	const int test_frames = 120;	/* How many frames to capture */
+	const int numsprites = 40;
+	const int size = 32;
+	const char *file = "SpeedTest.mcap";
+
+	FrameCapture *capture;
+	SDL_Surface *frame;
+	SDL_Rect rects[numsprites*2];
+	Uint8 **sources;
+	Uint32 colormap[256], seed, dropped;
+	Uint64 then, queue_time, close_time;
+	int i, n, row, f, numrects, numsources, decoded, differ, full;
+	int xpos[numsprites], ypos[numsprites];
+	Uint8 *pixels, color;
+	FILE *fp;
+	long bytes;
+
+	frame = SDL_CreateRGBSurface(0, screen->Width(), screen->Height(),
+								8, 0, 0, 0, 0);
+	if ( frame == NULL ) {
+		error("Couldn't create capture frame: %s\r\n", SDL_GetError());
+		return;
+	}
+	capture = new FrameCapture;
+	if ( capture->Open(file, frame->w, frame->h) < 0 ) {
+		error("Couldn't start capture: %s\r\n", capture->Error());
+		delete capture;
+		SDL_FreeSurface(frame);
+		return;
+	}
+	TestColormap(colormap);
+
+	/* A background of bands, with a noisy strip to copy */
+	seed = 1;
+	for ( row=0; row<frame->h; ++row ) {
+		pixels = (Uint8 *)frame->pixels + row*frame->pitch;
+		memset(pixels, row/16, frame->w);
+		if ( (row >= 200) && (row < 240) ) {
+			for ( i=0; i<frame->w; ++i ) {
+				seed = (seed * 1103515245) + 12345;
+				pixels[i] = (Uint8)(seed >> 16);
+			}
+		}
+	}
+	for ( i=0; i<numsprites; ++i ) {
+		seed = (seed * 1103515245) + 12345;
+		xpos[i] = (seed >> 8) % (frame->w-size);
+		ypos[i] = (seed >> 4) % (frame->h-size);
+	}
+
+	sources = new Uint8 *[test_frames];
+	numsources = 0;
+	queue_time = 0;
+	for ( f=0; f<test_frames; ++f ) {
+		/* Move the sprites, or every so often change everything */
+		full = ((f % 30) == 29);
+		numrects = 0;
+		if ( full ) {
+			for ( row=0; row<frame->h; ++row ) {
+				pixels = (Uint8 *)frame->pixels +
+							row*frame->pitch;
+				for ( i=0; i<frame->w; ++i ) {
+					++pixels[i];
+				}
+			}
+		}
+		for ( n=0; !full && (n<numsprites); ++n ) {
+			rects[numrects].x = xpos[n];
+			rects[numrects].y = ypos[n];
+			rects[numrects].w = size;
+			rects[numrects].h = size;
+			++numrects;
+			xpos[n] = (xpos[n] + 3) % (frame->w-size);
+			ypos[n] = (ypos[n] + 2) % (frame->h-size);
+			rects[numrects].x = xpos[n];
+			rects[numrects].y = ypos[n];
+			rects[numrects].w = size;
+			rects[numrects].h = size;
+			++numrects;
+			color = (Uint8)(n*5);
+			for ( row=0; row<size; ++row ) {
+				pixels = (Uint8 *)frame->pixels +
+					(ypos[n]+row)*frame->pitch + xpos[n];
+				for ( i=0; i<size; ++i ) {
+					pixels[i] = ((row^i) & 4) ?
+							color : (Uint8)(row+i);
+				}
+			}
+		}
+
+		dropped = capture->Dropped();
+		then = SDL_GetPerformanceCounter();
+		if ( capture->AddFrame(frame, rects, numrects,
+						full, colormap) < 0 ) {
+			break;
+		}
+		queue_time += SDL_GetPerformanceCounter()-then;
+
+		/* A dropped frame goes out with the next one */
+		if ( capture->Dropped() == dropped ) {
+			sources[numsources] = new Uint8[frame->w*frame->h];
+			for ( row=0; row<frame->h; ++row ) {
+				memcpy(sources[numsources] + row*frame->w,
+					(Uint8 *)frame->pixels + row*frame->pitch,
+								frame->w);
+			}
+			++numsources;
+		}
+	}
+	dropped = capture->Dropped();
+	then = SDL_GetPerformanceCounter();
+	if ( capture->Close() < 0 ) {
+		error("Capture failed: %s\r\n", capture->Error());
+	}
+	close_time = SDL_GetPerformanceCounter()-then;
+	delete capture;
+
+	bytes = 0;
+	fp = fopen(file, "rb");
+	if ( fp ) {
+		fseek(fp, 0, SEEK_END);
+		bytes = ftell(fp);
+		fclose(fp);
+	}
+	mesg("Capture of %d frames of %d sprites, %d dropped:\r\n",
+					test_frames, numsprites, dropped);
+	mesg("\t%6.1f us per frame queued, %6.1f ms writing the rest\r\n",
+		Elapsed(queue_time, MICROSECONDS, test_frames),
+		Elapsed(close_time, MILLISECONDS, 1));
+	mesg("\t%ld bytes, %ld per frame, %d per raw frame\r\n",
+		bytes, bytes/SDL_max(numsources, 1), frame->w*frame->h);
+
+	differ = DecodeCapture(file, sources, numsources, &decoded);
+	if ( differ < 0 ) {
+		error("\tThe capture doesn't decode after %d frames!\r\n",
+								decoded);
+	} else if ( differ || (decoded != numsources) ) {
+		error("\t%d of %d decoded frames differ from the source!\r\n",
+							differ, decoded);
+	} else {
+		mesg("\t%d frames decoded, all match the source\r\n", decoded);
+	}
+	remove(file);
+
+	for ( i=0; i<numsources; ++i ) {
+		delete[] sources[i];
+	}
+	delete[] sources;
+	SDL_FreeSurface(frame);
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the sprite compositor against erasing and redrawing       */
+
+/* Move the ships around on a screen, returning the microseconds per frame */
+static double ComposeFrames(FrameBuf *Screen, const AtlasFrame *ships,
+				int numsprites, int frames, int compose)
+{
+	int *xpos, *ypos, *xvel, *yvel;
+	int i, frame, size, w, h;
+	Uint32 seed;
+	Uint64 then;
+	const AtlasFrame *sprite;
+
+	size = SPRITES_WIDTH;
+	w = gClipRect.w;
+	h = gClipRect.h;
+	xpos = new int[numsprites];
+	ypos = new int[numsprites];
+	xvel = new int[numsprites];
+	yvel = new int[numsprites];
+	seed = 1;
+	for ( i=0; i<numsprites; ++i ) {
+		seed = (seed * 1103515245) + 12345;
+		xpos[i] = gClipRect.x + (seed >> 8) % (w-size);
+		ypos[i] = gClipRect.y + (seed >> 4) % (h-size);
+		xvel[i] = (int)((seed >> 16) % 9) - 4;
+		yvel[i] = (int)((seed >> 20) % 9) - 4;
+	}
+
+	Screen->Clear();
+	Screen->Update();
+	then = SDL_GetPerformanceCounter();
+	for ( frame=0; frame<frames; ++frame ) {
+		Screen->BeginFrame();
+		if ( compose ) {
+			Screen->StartSprites();
+		} else {
+			for ( i=0; i<numsprites; ++i ) {
+				Screen->Clear(xpos[i], ypos[i], size, size,
+									DOCLIP);
+			}
+		}
+		for ( i=0; i<numsprites; ++i ) {
+			xpos[i] += xvel[i];
+			if ( (xpos[i] < gClipRect.x) ||
+			     (xpos[i] > (gClipRect.x+w-size)) ) {
+				xvel[i] = -xvel[i];
+				xpos[i] += 2*xvel[i];
+			}
+			ypos[i] += yvel[i];
+			if ( (ypos[i] < gClipRect.y) ||
+			     (ypos[i] > (gClipRect.y+h-size)) ) {
+				yvel[i] = -yvel[i];
+				ypos[i] += 2*yvel[i];
+			}
+			sprite = &ships[(frame+i)%SHIP_FRAMES];
+			if ( compose ) {
+				Screen->QueueSprite(xpos[i], ypos[i], sprite);
+			} else {
+				Screen->QueueBlit(xpos[i], ypos[i], sprite);
+			}
+		}
+		Screen->Update();
+		Screen->EndFrame();
+	}
+	then = SDL_GetPerformanceCounter()-then;
+
+	/* Leave the screen clear, whichever way the sprites were drawn */
+	Screen->StartSprites();
+	Screen->Clear();
+	Screen->Update();
+
+	delete[] xpos;
+	delete[] ypos;
+	delete[] xvel;
+	delete[] yvel;
+	return(Elapsed(then, MICROSECONDS, frames));
+}
+static void ComposeTest(void)
+{
+	static struct {
+		const char *name;
+		int numsprites;
+	} loads[] = {
+		{ "Normal play",	20 },
+		{ "Heavy play",		100 },
+		{ "Pileup",		400 },
+	};
+	const int frames = 500;
+	double erase_us, compose_us;
+	unsigned int i;
+
+	mesg("Sprites erased and redrawn vs. composed, per frame:\r\n");
+	for ( i=0; i<SDL_arraysize(loads); ++i ) {
+		erase_us = ComposeFrames(screen, gPlayerShip->sprite,
+					loads[i].numsprites, frames, 0);
+		compose_us = ComposeFrames(screen, gPlayerShip->sprite,
+					loads[i].numsprites, frames, 1);
+		mesg("\t%-12s %3d sprites %8.1f us, %8.1f us, %5.2fx\r\n",
+			loads[i].name, loads[i].numsprites,
+			erase_us, compose_us, erase_us/compose_us);
+	}
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the 8-bit screen against one drawn in 32-bit color        */
+
+/* Make a screen like the game's, in the given mode, with the ship frames
+   loaded into it.
+ */
+static FrameBuf *TestScreen(Uint32 native, int scale,
+				Mac_Resource *spriteres, AtlasFrame *ships)
+{
+	FrameBuf *test;
+	Mac_ResData *S, *M;
+	int i;
+
+	test = new FrameBuf;
+	test->SetOptions((screen->Options() &
+			~(FRAMEBUF_NATIVE32|FRAMEBUF_RENDERTHREAD)) | native);
+	if ( (test->SetScale(scale) < 0) ||
+	     (test->Init(screen->Width(), screen->Height(), 0,
+					colors[gGammaCorrect]) < 0) ) {
+		error("Couldn't create test screen: %s\n", test->Error());
+		delete test;
+		return(NULL);
+	}
+	test->SetCaption("Maelstrom speed test");
+	test->ClipBlit(&gClipRect);
+
+	for ( i=0; i<SHIP_FRAMES; ++i ) {
+		S = spriteres->Resource("icl8", 200+i);
+		M = spriteres->Resource("ICN#", 200+i);
+		if ( (S == NULL) || (M == NULL) ||
+		     (test->AtlasImage(32, 32, S->data, M->data+128,
+							&ships[i]) < 0) ) {
+			error("Couldn't load ship frame %d\n", i);
+			delete test;
+			return(NULL);
+		}
+	}
+	return(test);
+}
+
+static void NativeTest(void)
+{
+	static const int loads[] = { 20, 100, 400 };
+	static const int scales[] = { 1, 0 };
+	const int frames = 500;
+	AtlasFrame ships[SHIP_FRAMES];
+	FrameBuf *test;
+	double times[2][SDL_arraysize(loads)];
+	unsigned int i, s;
+	int mode, scale;
+	LibPath library;
+	Mac_Resource spriteres(library.Path("Maelstrom Sprites"));
+
+	if ( spriteres.Error() ) {
+		error("%s\n", spriteres.Error());
+		return;
+	}
+
+	mesg("Composed ships, 8-bit vs. 32-bit screen, per frame:\r\n");
+	for ( s=0; s<SDL_arraysize(scales); ++s ) {
+		scale = 1;
+		for ( mode=0; mode<2; ++mode ) {
+			test = TestScreen(mode ? FRAMEBUF_NATIVE32 : 0,
+					scales[s], &spriteres, ships);
+			if ( test == NULL ) {
+				return;
+			}
+			/* Only the 8-bit screen scales as it converts */
+			if ( ! mode ) {
+				scale = test->Scale();
+			}
+			if ( (s > 0) && (scale == 1) ) {
+				delete test;
+				break;
+			}
+			for ( i=0; i<SDL_arraysize(loads); ++i ) {
+				times[mode][i] = ComposeFrames(test, ships,
+							loads[i], frames, 1);
+			}
+			delete test;
+		}
+		if ( mode < 2 ) {
+			/* The display isn't big enough to scale up */
+			break;
+		}
+		mesg("\tScaled %dx:\r\n", scale);
+		for ( i=0; i<SDL_arraysize(loads); ++i ) {
+			mesg("\t%4d sprites %8.1f us, %8.1f us, %5.2fx\r\n",
+				loads[i], times[0][i], times[1][i],
+						times[0][i]/times[1][i]);
+		}
+	}
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the frames -interpolate draws between the time steps      */
+
+static void InterpolateTest(void)
+{
+	static const struct {
+		const char *name;
+		int numsprites;
+	} loads[] = {
+		{ "Normal", 20 },
+		{ "Heavy", 100 },
+		{ "Swarm", 400 },
+	};
+	static const int rates[] = { 60, 120, 144 };
+	const int steps = 200;		/* Time steps to run */
+	const int between = 4;		/* Frames drawn in each time step */
+	const double step_us = (FRAME_DELAY*1000000.0)/60;
+	Object **objects;
+	Uint64 then, move_time, draw_time;
+	double move_us, draw_us, frames;
+	unsigned int i, r;
+	int j, step, frame, x, y;
+
+	mesg("Rocks moved a time step and drawn between, in a %.1f ms step:\r\n",
+							step_us/1000);
+	screen->Clear();
+	screen->Update();
+	for ( i=0; i<SDL_arraysize(loads); ++i ) {
+		objects = new Object *[loads[i].numsprites];
+		for ( j=0; j<loads[i].numsprites; ++j ) {
+			x = gScrnRect.left +
+				FastRandom(gScrnRect.right-gScrnRect.left);
+			y = gScrnRect.top +
+				FastRandom(gScrnRect.bottom-gScrnRect.top);
+			objects[j] = new Object(x*SCALE_FACTOR, y*SCALE_FACTOR,
+					FastRandom(2*VEL_MAX+1)-VEL_MAX,
+					FastRandom(2*VEL_MAX+1)-VEL_MAX, gRock1R, 1);
+		}
+
+		/* What the game loop does each time step, and in between */
+		move_time = draw_time = 0;
+		for ( step=0; step<steps; ++step ) {
+			then = SDL_GetPerformanceCounter();
+			for ( j=0; j<loads[i].numsprites; ++j ) {
+				objects[j]->Move(0);
+			}
+			move_time += SDL_GetPerformanceCounter()-then;
+
+			then = SDL_GetPerformanceCounter();
+			for ( frame=0; frame<between; ++frame ) {
+				screen->BeginFrame();
+				screen->StartSprites();
+				for ( j=0; j<loads[i].numsprites; ++j ) {
+					objects[j]->BlitSprite(
+						(frame*BLEND_ONE)/between);
+				}
+				screen->Update();
+				screen->EndFrame();
+			}
+			draw_time += SDL_GetPerformanceCounter()-then;
+		}
+		move_us = Elapsed(move_time, MICROSECONDS, steps);
+		draw_us = Elapsed(draw_time, MICROSECONDS, steps*between);
+		mesg("\t%-8s %3d sprites %8.1f us a step, %8.1f us a frame\r\n",
+			loads[i].name, loads[i].numsprites, move_us, draw_us);
+
+		/* Each refresh is a frame, one of them drawn by the step */
+		for ( r=0; r<SDL_arraysize(rates); ++r ) {
+			frames = (rates[r]*FRAME_DELAY)/60.0;
+			mesg("\t\t%3d Hz %4.1f frames a step, %5.1f%% of a core\r\n",
+				rates[r], frames,
+				((move_us+frames*draw_us)*100)/step_us);
+		}
+
+		for ( j=0; j<loads[i].numsprites; ++j ) {
+			delete objects[j];
+		}
+		delete[] objects;
+	}
+	screen->StartSprites();
+	screen->Clear();
+	screen->Update();
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time hit detection with and without the grid broad phase       */
+
+static int HitOverlap(const Rect *R1, const Rect *R2)
+{
+	return(!((R1->top > R2->bottom) || (R1->bottom < R2->top) ||
+		 (R1->left > R2->right) || (R1->right < R2->left)));
+}
+static void RandomHitRect(Rect *R, int size)
+{
+	R->left = gScrnRect.left +
+		FastRandom(gScrnRect.right-gScrnRect.left+size) - size;
+	R->top = gScrnRect.top +
+		FastRandom(gScrnRect.bottom-gScrnRect.top+size) - size;
+	R->right = R->left+size-1;
+	R->bottom = R->top+size-1;
+}
+
+/* Check every sprite against every ship the way RunFrame() does, the
+   first shot of the ship that overlaps it and then the ship itself, and
+   return a checksum of the hits in the order they were found.
+ */
+static Uint32 FindHits(const Rect *sprites, int numsprites,
+			const Rect *ships, const Rect *shots, int numships,
+			HitGrid *grid, int *checked)
+{
+	Uint32 sum;
+	int i, j, k;
+
+	sum = 0;
+	for ( j=numships-1; j>=0; --j ) {
+		if ( grid ) {
+			grid->Clear();
+			for ( k=0; k<MAX_SHOTS; ++k ) {
+				grid->Add(&shots[j*MAX_SHOTS+k]);
+			}
+			grid->Add(&ships[j]);
+		}
+		for ( i=numsprites-1; i>=0; --i ) {
+			if ( grid && ! grid->Touches(&sprites[i]) ) {
+				continue;
+			}
+			++*checked;
+			for ( k=MAX_SHOTS-1; k>=0; --k ) {
+				if ( HitOverlap(&shots[j*MAX_SHOTS+k], &sprites[i]) ) {
+					sum = (sum*31)+(j*MAX_SHOTS+k)*numsprites+i;
+					break;
+				}
+			}
+			if ( HitOverlap(&ships[j], &sprites[i]) ) {
+				sum = (sum*31)+j*numsprites+i+1;
+			}
+		}
+	}
+	return(sum);
+}
+
+static void HitsTest(void)
+{
+	static const struct {
+		const char *name;
+		int numsprites;
+		int numships;
+	} loads[] = {
+		{ "Game", 100, 1 },
+		{ "Network", 100, 3 },
+		{ "Crowd", 1000, 10 },
+		{ "Stress", 4000, 100 },
+	};
+	const int reps = 20;
+	HitGrid grid;
+	Rect *sprites, *ships, *shots;
+	Uint32 brute_sum, grid_sum;
+	Uint64 then, brute_time, grid_time;
+	unsigned int i;
+	int j, rep, brute_checked, grid_checked;
+
+	mesg("Hit detection, every sprite vs. the grid broad phase:\r\n");
+	for ( i=0; i<SDL_arraysize(loads); ++i ) {
+		sprites = new Rect[loads[i].numsprites];
+		ships = new Rect[loads[i].numships];
+		shots = new Rect[loads[i].numships*MAX_SHOTS];
+		for ( j=0; j<loads[i].numsprites; ++j ) {
+			RandomHitRect(&sprites[j], SPRITES_WIDTH-4);
+		}
+		for ( j=0; j<loads[i].numships; ++j ) {
+			RandomHitRect(&ships[j], SPRITES_WIDTH-4);
+		}
+		for ( j=0; j<loads[i].numships*MAX_SHOTS; ++j ) {
+			RandomHitRect(&shots[j], 4);
+		}
+
+		brute_sum = grid_sum = 0;
+		brute_checked = grid_checked = 0;
+		then = SDL_GetPerformanceCounter();
+		for ( rep=0; rep<reps; ++rep ) {
+			brute_sum = FindHits(sprites, loads[i].numsprites,
+					ships, shots, loads[i].numships,
+					NULL, &brute_checked);
+		}
+		brute_time = SDL_GetPerformanceCounter()-then;
+		then = SDL_GetPerformanceCounter();
+		for ( rep=0; rep<reps; ++rep ) {
+			grid_sum = FindHits(sprites, loads[i].numsprites,
+					ships, shots, loads[i].numships,
+					&grid, &grid_checked);
+		}
+		grid_time = SDL_GetPerformanceCounter()-then;
+
+		mesg("\t%-8s %4d sprites %4d shots %8.1f us, %8.1f us, %5.2fx, %3d%% checked%s\r\n",
+			loads[i].name, loads[i].numsprites,
+			loads[i].numships*MAX_SHOTS,
+			Elapsed(brute_time, MICROSECONDS, reps),
+			Elapsed(grid_time, MICROSECONDS, reps),
+			(double)brute_time/grid_time,
+			(grid_checked*100)/brute_checked,
+			(grid_sum == brute_sum) ? "" : ", DIFFERENT HITS");
+
+		delete[] sprites;
+		delete[] ships;
+		delete[] shots;
+	}
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the bit packed masks Collide() tests a row at a time      */
+
+static int PackedCollide(const Blit *blit1, int index1, int row1, int col1,
+			const Blit *blit2, int index2, int row2, int col2,
+						int width, int height)
+{
+	const SpriteMask *mask1 = &blit1->mask[index1];
+	const SpriteMask *mask2 = &blit2->mask[index2];
+
+	if ( blit1->isSmall ) {
+		if ( blit2->isSmall )
+			return(CollideMasks(mask1->small, row1, col1,
+				mask2->small, row2, col2, width, height));
+		return(CollideMasks(mask1->small, row1, col1,
+				mask2->large, row2, col2, width, height));
+	}
+	if ( blit2->isSmall )
+		return(CollideMasks(mask1->large, row1, col1,
+				mask2->small, row2, col2, width, height));
+	return(CollideMasks(mask1->large, row1, col1,
+				mask2->large, row2, col2, width, height));
+}
+
+/* The answer the packed masks should give, a pixel at a time */
+static int PixelCollide(const Blit *blit1, int index1, int row1, int col1,
+			const Blit *blit2, int index2, int row2, int col2,
+						int width, int height)
+{
+	int size1, size2, x, y;
+
+	size1 = (blit1->isSmall ? 16 : 32);
+	size2 = (blit2->isSmall ? 16 : 32);
+	for ( y=0; y<height; ++y ) {
+		if ( (row1+y >= size1) || (row2+y >= size2) ) {
+			break;
+		}
+		for ( x=0; x<width; ++x ) {
+			if ( MaskPixel(blit1, index1, col1+x, row1+y) &&
+			     MaskPixel(blit2, index2, col2+x, row2+y) ) {
+				return(1);
+			}
+		}
+	}
+	return(0);
+}
+
+typedef struct {
+	int index1, row1, col1;
+	int index2, row2, col2;
+	int width, height;
+} CollideCase;
+
+static void CollideTest(void)
+{
+	const int numtests = 20000;	/* Overlapping pairs to test */
+	const int test_reps = 20;	/* How many times to test each */
+
+	/* The nanoseconds per pair with a byte per mask pixel and with the
+	   packed rows that replaced them, recorded together on one machine
+	   when they were replaced, with these same cases.
+	 */
+	static const struct {
+		const char *name;
+		BlitPtr *blit1, *blit2;
+		double before_ns, after_ns;
+	} pairs[] = {
+		{ "Ship/rock",	&gPlayerShip,	&gRock1R,	205.0,	62.0 },
+		{ "Ship/small",	&gPlayerShip,	&gRock3R,	175.0,	90.0 },
+		{ "Small/ship",	&gRock3R,	&gPlayerShip,	122.0,	58.0 },
+	};
+	CollideCase *tests;
+	const Blit *blit1, *blit2;
+	int size1, size2;
+	Uint64 then, elapsed;
+	unsigned int i;
+	int j, rep, hits, mismatches;
+
+	/* The same cases every time, so the recorded times still apply */
+	SeedRandom(1);
+	tests = new CollideCase[numtests];
+	mesg("Pixel collisions, now and as recorded byte vs. packed masks:\r\n");
+	for ( i=0; i<SDL_arraysize(pairs); ++i ) {
+		blit1 = *pairs[i].blit1;
+		blit2 = *pairs[i].blit2;
+		size1 = (blit1->isSmall ? 16 : 32);
+		size2 = (blit2->isSmall ? 16 : 32);
+
+		/* Overlaps like the ones Collide() works out from the
+		   hit rectangles, the first sprite always to the left.
+		 */
+		for ( j=0; j<numtests; ++j ) {
+			tests[j].index1 = FastRandom(blit1->numFrames);
+			tests[j].index2 = FastRandom(blit2->numFrames);
+			tests[j].col1 = FastRandom(size1);
+			tests[j].col2 = 0;
+			tests[j].width = FastRandom(SDL_min(size1-tests[j].col1,
+								size2)+1);
+			if ( FastRandom(2) ) {
+				tests[j].row1 = FastRandom(size1);
+				tests[j].row2 = 0;
+			} else {
+				tests[j].row1 = 0;
+				tests[j].row2 = FastRandom(size2);
+			}
+			tests[j].height = FastRandom(size1+1);
+		}
+
+		hits = 0;
+		then = SDL_GetPerformanceCounter();
+		for ( rep=0; rep<test_reps; ++rep ) {
+			for ( j=0; j<numtests; ++j ) {
+				hits += PackedCollide(
+					blit1, tests[j].index1,
+					tests[j].row1, tests[j].col1,
+					blit2, tests[j].index2,
+					tests[j].row2, tests[j].col2,
+					tests[j].width, tests[j].height);
+			}
+		}
+		elapsed = SDL_GetPerformanceCounter()-then;
+
+		mismatches = 0;
+		for ( j=0; j<numtests; ++j ) {
+			if ( PixelCollide(blit1, tests[j].index1,
+					tests[j].row1, tests[j].col1,
+					blit2, tests[j].index2,
+					tests[j].row2, tests[j].col2,
+					tests[j].width, tests[j].height) !=
+			     PackedCollide(blit1, tests[j].index1,
+					tests[j].row1, tests[j].col1,
+					blit2, tests[j].index2,
+					tests[j].row2, tests[j].col2,
+					tests[j].width, tests[j].height) ) {
+				++mismatches;
+			}
+		}
+
+		mesg("\t%-12s %7.1f ns, recorded %7.1f ns, %7.1f ns, %5.2fx, %3d%% hits, %d different\r\n",
+			pairs[i].name,
+			Elapsed(elapsed, NANOSECONDS, numtests*test_reps),
+			pairs[i].before_ns, pairs[i].after_ns,
+			pairs[i].before_ns/pairs[i].after_ns,
+			(hits*100)/(numtests*test_reps), mismatches);
+	}
+	delete[] tests;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Count the pixel tests the frame boxes save in a scripted game  */
+
+static void BoundsTest(void)
+{
+	static const struct {
+		BlitPtr *blit;
+		int count;
+		int phasetime;
+	} kinds[] = {
+		{ &gPlayerShip, 2, 1 },
+		{ &gRock1R, 4, 2 },
+		{ &gRock1L, 4, 2 },
+		{ &gRock2R, 8, 2 },
+		{ &gRock2L, 8, 2 },
+		{ &gRock3R, 12, 2 },
+		{ &gRock3L, 12, 2 },
+	};
+	const int frames = 3000;	/* 100 seconds of time steps */
+	Object **objects;
+#ifdef COLLIDE_STATS
+	CollideStats before;
+	Uint32 masks, rejects;
+#endif
+	Uint32 pairs, hits;
+	Uint64 then, elapsed;
+	unsigned int i;
+	int j, k, frame, numobjects, x, y;
+
+	/* The same rocks on the same courses every time */
+	SeedRandom(1);
+	numobjects = 0;
+	for ( i=0; i<SDL_arraysize(kinds); ++i ) {
+		numobjects += kinds[i].count;
+	}
+	objects = new Object *[numobjects];
+	numobjects = 0;
+	for ( i=0; i<SDL_arraysize(kinds); ++i ) {
+		for ( j=0; j<kinds[i].count; ++j ) {
+			x = gScrnRect.left +
+				FastRandom(gScrnRect.right-gScrnRect.left);
+			y = gScrnRect.top +
+				FastRandom(gScrnRect.bottom-gScrnRect.top);
+			objects[numobjects++] = new Object(
+				x*SCALE_FACTOR, y*SCALE_FACTOR,
+				FastRandom(VEL_MAX+1)-VEL_MAX/2,
+				FastRandom(VEL_MAX+1)-VEL_MAX/2,
+				*kinds[i].blit, kinds[i].phasetime);
+		}
+	}
+
+	/* Every pair is tested, the way the hit detection tests them */
+#ifdef COLLIDE_STATS
+	before = gCollideStats;
+#endif
+	pairs = hits = 0;
+	elapsed = 0;
+	for ( frame=0; frame<frames; ++frame ) {
+		for ( j=0; j<numobjects; ++j ) {
+			objects[j]->Move(0);
+		}
+		then = SDL_GetPerformanceCounter();
+		for ( j=0; j<numobjects; ++j ) {
+			for ( k=j+1; k<numobjects; ++k ) {
+				hits += objects[j]->Collide(objects[k]);
+				++pairs;
+			}
+		}
+		elapsed += SDL_GetPerformanceCounter()-then;
+	}
+
+	mesg("Pixel tests of %d ships and rocks over %d time steps:\r\n",
+							numobjects, frames);
+	mesg("\t%u pairs, %u hit, %6.1f ns per pair\r\n", pairs, hits,
+		Elapsed(elapsed, NANOSECONDS, pairs));
+#ifdef COLLIDE_STATS
+	masks = gCollideStats.masks-before.masks;
+	rejects = gCollideStats.rejects-before.rejects;
+	mesg("\t%u hit rectangles overlapped\r\n", masks);
+	mesg("\tRejected early: %5.2f%% by hit rectangles, %5.2f%% with frame boxes\r\n",
+			((pairs-masks)*100.0)/pairs,
+			((pairs-masks+rejects)*100.0)/pairs);
+	mesg("\tMask tests skipped: %u of %u, mask rows tested: %u of %u\r\n",
+		rejects, masks, gCollideStats.rows-before.rows,
+		gCollideStats.full_rows-before.full_rows);
+#else
+	mesg("\tBuild with COLLIDE_STATS defined to count the pixel tests\r\n");
+#endif
+
+	for ( j=0; j<numobjects; ++j ) {
+		delete objects[j];
+	}
+	delete[] objects;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time moving rocks one Move() at a time and with gMotion.Coast() */
+
+/* Make the same rocks every time, move them 'steps' time steps, and
+   return the time it took, with a checksum of where they ended up.
+ */
+static Uint64 CoastRocks(int numrocks, int steps, int coast, Uint32 *sum)
+{
+	Object **objects;
+	Uint64 then, elapsed;
+	int j, step, x, y;
+
+	SeedRandom(1);
+	objects = new Object *[numrocks];
+	for ( j=0; j<numrocks; ++j ) {
+		x = gScrnRect.left + FastRandom(gScrnRect.right-gScrnRect.left);
+		y = gScrnRect.top + FastRandom(gScrnRect.bottom-gScrnRect.top);
+		objects[j] = new Object(x*SCALE_FACTOR, y*SCALE_FACTOR,
+				FastRandom(2*VEL_MAX+1)-VEL_MAX,
+				FastRandom(2*VEL_MAX+1)-VEL_MAX,
+				(j%2) ? gRock2R : gRock1L, 1+(j%3));
+	}
+
+	then = SDL_GetPerformanceCounter();
+	for ( step=0; step<steps; ++step ) {
+		if ( coast ) {
+			gMotion.Coast(0);
+			for ( j=numrocks-1; j>=0; --j ) {
+				objects[j]->Step(0);
+			}
+		} else {
+			for ( j=numrocks-1; j>=0; --j ) {
+				objects[j]->Move(0);
+			}
+		}
+	}
+	elapsed = SDL_GetPerformanceCounter()-then;
+
+	/* Where they are, and what they hit with their phase there */
+	*sum = 0;
+	for ( j=0; j<numrocks; ++j ) {
+		objects[j]->GetPos(&x, &y);
+		*sum = (*sum * 31) + x;
+		*sum = (*sum * 31) + y;
+		if ( j > 0 ) {
+			*sum += objects[j]->Collide(objects[j-1]);
+		}
+	}
+
+	for ( j=0; j<numrocks; ++j ) {
+		delete objects[j];
+	}
+	delete[] objects;
+	return(elapsed);
+}
+
+static void CoastTest(void)
+{
+	static const int loads[] = { MAX_SPRITES, 1000, 4000 };
+	const int steps = 1000;
+	Uint64 moved, coasted;
+	Uint32 movesum, coastsum;
+	unsigned int i;
+
+	mesg("Rocks moved a time step with Move() and with Coast():\r\n");
+	for ( i=0; i<SDL_arraysize(loads); ++i ) {
+		moved = CoastRocks(loads[i], steps, 0, &movesum);
+		coasted = CoastRocks(loads[i], steps, 1, &coastsum);
+		mesg("\t%4d rocks: %9.1f ns with Move(), %9.1f ns with Coast(), %s\r\n",
+			loads[i], Elapsed(moved, NANOSECONDS, steps),
+			Elapsed(coasted, NANOSECONDS, steps),
+			(movesum == coastsum) ? "same" : "DIFFERENT");
+	}
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time a nova wiping out a screen full of rocks                   */
+
+/* Fill the screen with rocks around a nova, leaving room in gSprites[]
+   for the rocks they split into, and set it off.  Returns the time the
+   nova's blast took, and in 'clear', the time to delete all the sprites
+   after, the way the end of a wave does.
+ */
+static Uint64 NovaWave(Uint64 *clear)
+{
+	const int numrocks[3] = { 12, 7, 19 };	/* Large, medium, small */
+	Uint64 then, blast;
+	int i, j, x, y, xVel, yVel, newsprite, boomdelay, shaketime;
+
+	boomdelay = gBoomDelay;
+	shaketime = gShakeTime;
+	gSprites[0] = new Nova(gScrnRect.right*SCALE_FACTOR/2,
+					gScrnRect.bottom*SCALE_FACTOR/2);
+	for ( i=0; i<3; ++i ) {
+		for ( j=0; j<numrocks[i]; ++j ) {
+			x = gScrnRect.left +
+				FastRandom(gScrnRect.right-gScrnRect.left);
+			y = gScrnRect.top +
+				FastRandom(gScrnRect.bottom-gScrnRect.top);
+			xVel = FastRandom(2*VEL_MAX+1)-VEL_MAX;
+			yVel = FastRandom(2*VEL_MAX+1)-VEL_MAX;
+			newsprite = gNumSprites;
+			switch (i) {
+				case 0:
+					gSprites[newsprite] = new LargeRock(
+						x*SCALE_FACTOR, y*SCALE_FACTOR,
+						xVel, yVel, 2);
+					break;
+				case 1:
+					gSprites[newsprite] = new MediumRock(
+						x*SCALE_FACTOR, y*SCALE_FACTOR,
+						xVel, yVel, 2);
+					break;
+				default:
+					gSprites[newsprite] = new SmallRock(
+						x*SCALE_FACTOR, y*SCALE_FACTOR,
+						xVel, yVel, 2);
+					break;
+			}
+		}
+	}
+
+	/* The rocks all blow up, and the big ones split */
+	then = SDL_GetPerformanceCounter();
+	if ( gSprites[0]->BeenTimedOut() < 0 ) {
+		delete gSprites[0];
+		gSprites[0] = gSprites[gNumSprites];
+	}
+	blast = SDL_GetPerformanceCounter()-then;
+
+	then = SDL_GetPerformanceCounter();
+	while ( gNumSprites > 0 ) {
+		delete gSprites[gNumSprites-1];
+	}
+	*clear = SDL_GetPerformanceCounter()-then;
+
+	gBoomDelay = boomdelay;
+	gShakeTime = shaketime;
+	return(blast);
+}
+
+static void NovaWaves(const char *name, int waves)
+{
+	Uint64 blast, clear, blast_total, blast_worst, clear_total, clear_worst;
+	int wave;
+
+	SeedRandom(1);
+	blast_total = blast_worst = clear_total = clear_worst = 0;
+	for ( wave=0; wave<waves; ++wave ) {
+		blast = NovaWave(&clear);
+		blast_total += blast;
+		clear_total += clear;
+		if ( blast > blast_worst ) {
+			blast_worst = blast;
+		}
+		if ( clear > clear_worst ) {
+			clear_worst = clear;
+		}
+	}
+	mesg("\t%-6s blast %6.1f us, worst %6.1f us, clear %6.1f us, worst %6.1f us\r\n",
+		name, Elapsed(blast_total, MICROSECONDS, waves),
+		Elapsed(blast_worst, MICROSECONDS, 1),
+		Elapsed(clear_total, MICROSECONDS, waves),
+		Elapsed(clear_worst, MICROSECONDS, 1));
+}
+
+static void NovaTest(void)
+{
+	const int waves = 500;
+	ObjectPool *pool;
+	const ObjectPoolStats *stats;
+	void **held;
+	int i, numheld;
+
+	mesg("A nova blowing up a screen of rocks, %d times:\r\n", waves);
+	NovaWaves("pools", waves);
+
+	/* Each pool's count of objects, before they are filled up below */
+	for ( pool=ObjectPool::First(); pool; pool=pool->Next() ) {
+		stats = pool->Stats();
+		if ( stats->peak ) {
+			mesg("\t\t%-11s %3d live, %3d peak of %3d, %d from the heap\r\n",
+				pool->Name(), stats->live, stats->peak,
+				pool->Capacity(), stats->overflows);
+		}
+	}
+
+	/* With every pool full, the objects all come from the heap */
+	numheld = 0;
+	for ( pool=ObjectPool::First(); pool; pool=pool->Next() ) {
+		numheld += pool->Capacity();
+	}
+	held = new void *[numheld];
+	numheld = 0;
+	for ( pool=ObjectPool::First(); pool; pool=pool->Next() ) {
+		for ( i=0; i<pool->Capacity(); ++i ) {
+			held[numheld++] = pool->Alloc(1);
+		}
+	}
+	NovaWaves("heap", waves);
+	numheld = 0;
+	for ( pool=ObjectPool::First(); pool; pool=pool->Next() ) {
+		for ( i=0; i<pool->Capacity(); ++i ) {
+			pool->Free(held[numheld++]);
+		}
+	}
+	delete[] held;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time the status bar text and a dialog's saved screen area      */
+
+static void PrintPoolStats(const char *name, const SurfacePoolStats *stats,
+					const SurfacePoolStats *before)
+{
+	mesg("\t%-6s %6d hits, %6d misses, %6d bytes held\r\n", name,
+			stats->hits-before->hits, stats->misses-before->misses,
+							stats->bytes_held);
+}
+
+static void TextTest(void)
+{
+	const int test_reps = 1000;	/* How many frames to draw */
+
+	SurfacePoolStats text_before, areas_before;
+	TextCacheStats cache_before;
+	const TextCacheStats *cache;
+	MFont *geneva;
+	SDL_Surface *saved;
+	char numbuf[32];
+	Uint32 then, now;
+	int i;
+
+	if ( (geneva = fontserv->NewFont("Geneva", 9)) == NULL ) {
+		error("Can't use Geneva font!\n");
+		return;
+	}
+	cache_before = *fontserv->CacheStats();
+	text_before = *fontserv->TextStats();
+	areas_before = *screen->AreaStats();
+
+	screen->Clear();
+	screen->Update();
+	then = SDL_GetTicks();
+	for ( i=0; i<test_reps; ++i ) {
+		screen->BeginFrame();
+		screen->FillRect(45, gStatusLine+1, 100, 12, 0);
+		SDL_snprintf(numbuf, sizeof(numbuf), "%d", i*25);
+		DrawText(45, gStatusLine+11, numbuf, geneva, STYLE_BOLD,
+							0xFF, 0xFF, 0xFF);
+		SDL_snprintf(numbuf, sizeof(numbuf), "%d", i%10);
+		DrawText(255, gStatusLine+11, numbuf, geneva, STYLE_BOLD,
+							0xFF, 0xFF, 0xFF);
+
+		/* What Maclike_Dialog saves and restores around a dialog */
+		saved = screen->GrabArea(120, 100, 400, 240);
+		if ( saved ) {
+			screen->QueueBlit(120, 100, saved, NOCLIP);
+			screen->FreeImage(saved);
+		}
+		screen->Update();
+		screen->EndFrame();
+	}
+	now = SDL_GetTicks();
+	mesg("Text and dialog areas took %d microseconds per frame:\r\n",
+					((now-then)*1000)/test_reps);
+	cache = fontserv->CacheStats();
+	mesg("\tcache  %6d hits, %6d misses, %6d evictions, %6d bytes\r\n",
+		cache->hits-cache_before.hits, cache->misses-cache_before.misses,
+		cache->evictions-cache_before.evictions, cache->bytes);
+	PrintPoolStats("text", fontserv->TextStats(), &text_before);
+	PrintPoolStats("areas", screen->AreaStats(), &areas_before);
+	screen->Clear();
+	screen->Update();
+
+	delete geneva;
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Time text drawn from the glyph atlas in the game's fonts       */
+
+static void FontTest(void)
+{
+	const int test_reps = 2000;	/* How many times to draw the text */
+
+	/* What DrawStatus() and the dialogs draw, in the fonts they use */
+	static const char *status_text[] = {
+		"Score:", "Shield:", "Wave:", "Lives:", "Bonus:", "Frags:",
+		"123450", "12", "3", "2000", NULL
+	};
+	static const char *dialog_text[] = {
+		"OK", "Cancel", "That key is in use!", "Fire", "Thrust",
+		"Turn Clockwise", "Turn Counter-Clockwise", "Shield", NULL
+	};
+	static const char *score_text[] = {
+		"Enter your name: ", "Sam Lantinga", "1234560", NULL
+	};
+
+	/* The microseconds per string drawn from the NFNT bits a bit at a
+	   time, and from the glyph atlas that replaced them, recorded
+	   together on one machine when the atlas went in.
+	 */
+	static struct {
+		const char *workload, *name;
+		int size;
+		Uint8 style;
+		const char **text;
+		double before_us, after_us;
+	} fonts[] = {
+		{ "Status bar",	"Geneva",	9,	STYLE_BOLD,	status_text,
+								1.65,	1.30 },
+		{ "Dialogs",	"Chicago",	12,	STYLE_NORM,	dialog_text,
+								2.45,	1.80 },
+		{ "High scores","New York",	18,	STYLE_NORM,	score_text,
+								6.00,	3.05 },
+	};
+	SDL_Surface *image;
+	MFont *font;
+	Uint64 then;
+	unsigned int i;
+	int rep, j;
+
+	mesg("Text per string, now and as recorded NFNT bits vs. glyph atlas:\r\n");
+	for ( i=0; i<SDL_arraysize(fonts); ++i ) {
+		font = fontserv->NewFont(fonts[i].name, fonts[i].size);
+		if ( font == NULL ) {
+			error("Can't use %s font!\n", fonts[i].name);
+			continue;
+		}
+
+		/* A different color every time, so the text isn't cached */
+		then = SDL_GetPerformanceCounter();
+		for ( rep=0; rep<test_reps; ++rep ) {
+			for ( j=0; fonts[i].text[j]; ++j ) {
+				image = fontserv->TextImage(fonts[i].text[j],
+					font, fonts[i].style,
+					rep&0xFF, (rep>>8)&0xFF, j);
+				fontserv->FreeText(image);
+			}
+		}
+		mesg("\t%-12s %-9s %8.2f us, recorded %8.2f us, %8.2f us, %5.2fx\r\n",
+			fonts[i].workload, fonts[i].name,
+			Elapsed(SDL_GetPerformanceCounter()-then,
+						MICROSECONDS, test_reps*j),
+			fonts[i].before_us, fonts[i].after_us,
+			fonts[i].before_us/fonts[i].after_us);
+		delete font;
+	}
+}
+
+/* ----------------------------------------------------------------- */
+/* -- Run the named speed test, or all of them                       */
+
+static struct {
+	const char *name;
+	void (*run)(void);
+} speedtests[] = {
+	{ "sprite",	SpriteTest },
+	{ "blit",	BlitTest },
+	{ "draw",	DrawTest },
+	{ "convert",	ConvertTest },
+	{ "bands",	BandsTest },
+	{ "dirty",	DirtyTest },
+	{ "capture",	CaptureTest },
+	{ "compose",	ComposeTest },
+	{ "native",	NativeTest },
+	{ "interpolate", InterpolateTest },
+	{ "hits",	HitsTest },
+	{ "collide",	CollideTest },
+	{ "bounds",	BoundsTest },
+	{ "coast",	CoastTest },
+	{ "nova",	NovaTest },
+	{ "text",	TextTest },
+	{ "font",	FontTest },
+};
+#define NUM_SPEEDTESTS	(sizeof(speedtests)/sizeof(speedtests[0]))
+
+int RunSpeedTest(const char *which)
+{
+	unsigned int i;
+	int ran;
+
+	ran = 0;
+	for ( i=0; i<NUM_SPEEDTESTS; ++i ) {
+		if ( !which || (strcmp(which, speedtests[i].name) == 0) ) {
+			speedtests[i].run();
+			++ran;
+		}
+	}
+	if ( ! ran ) {
+		error("Unknown speed test '%s', choose one of:", which);
+		for ( i=0; i<NUM_SPEEDTESTS; ++i ) {
+			error(" %s", speedtests[i].name);
+		}
+		error("\n");
+		return(-1);
+	}
+	return(0);
+}